@@ -0,0 +1,64 @@
+#include "memory.h"
+
+#include <cstdlib>
+#include <new>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+// Replaces the global operator new and delete so memory.cpp can count every
+// heap block. Blocks are measured with the allocator's own usable size, so no
+// header is added to them and the counts include the allocator's rounding.
+
+static size_t blockSize(void* block) {
+#ifdef __APPLE__
+    return malloc_size(block);
+#else
+    return malloc_usable_size(block);
+#endif
+}
+
+void* operator new(size_t size) {
+    if (size == 0) size = 1;
+    if (!allocationAllowed(size)) throw std::bad_alloc();
+    void* block = malloc(size);
+    if (!block) throw std::bad_alloc();
+    noteAllocation(blockSize(block));
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* block) noexcept {
+    if (!block) return;
+    noteRelease(blockSize(block));
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    operator delete(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+    operator delete(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+    operator delete(block);
+}
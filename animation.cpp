@@ -0,0 +1,163 @@
+#include "animation.h"
+#include "lod.h"
+#include "projections.h"
+
+using namespace std;
+using namespace Eigen;
+
+Animation::Animation(vector<Keyframe> keyframes) : keyframes_(std::move(keyframes)) {
+    for (const Keyframe& key : keyframes_) {
+        // linear = U S V^T = (U V^T)(V S V^T), with the sign of a reflection moved into the stretch
+        JacobiSVD<Matrix3d> svd(key.pose.linear, ComputeFullU | ComputeFullV);
+        Matrix3d U = svd.matrixU();
+        const Matrix3d& V = svd.matrixV();
+        if ((U * V.transpose()).determinant() < 0) U.col(2) = -U.col(2);
+        Matrix3d rotation = U * V.transpose();
+
+        PoseParts parts;
+        parts.rotation = Quaterniond(rotation);
+        parts.stretch = rotation.transpose() * key.pose.linear;
+        parts.translation = key.pose.translation;
+        parts_.push_back(parts);
+    }
+}
+
+AffineMap Animation::poseAt(double t) const {
+    double length = duration();
+    if (keyframes_.size() == 1 || length <= 0) return keyframes_[0].pose;
+    t = fmod(t, length);
+    if (t < 0) t += length;
+
+    size_t next = 1;
+    while (next + 1 < keyframes_.size() && keyframes_[next].time < t) ++next;
+    const Keyframe& a = keyframes_[next - 1];
+    const Keyframe& b = keyframes_[next];
+    double span = b.time - a.time;
+    double s = span > 0 ? min(1.0, max(0.0, (t - a.time) / span)) : 1.0;
+
+    const PoseParts& from = parts_[next - 1];
+    const PoseParts& to = parts_[next];
+    Quaterniond rotation = Quaterniond(from.rotation).slerp(s, Quaterniond(to.rotation));
+    AffineMap pose;
+    pose.linear = rotation.toRotationMatrix() * ((1 - s) * from.stretch + s * to.stretch);
+    pose.translation = (1 - s) * from.translation + s * to.translation;
+    return pose;
+}
+
+AffineMap transformOpMap(const TransformOp& op) {
+    const double* p = op.params;
+    switch (op.kind) {
+        case TRANSFORM_ROTATE: return rotationMap(p[0], p[1], p[2], p[3]);
+        case TRANSFORM_TRANSLATE: return translationMap(p[0], p[1], p[2]);
+        case TRANSFORM_SCALE: return scaleMap(p[0], p[1], p[2]);
+        default: return reflectionMap(p[0], p[1], p[2], p[3]);
+    }
+}
+
+AnimationPlayer::AnimationPlayer(shared_ptr<const Animation> animation, shared_ptr<const Polyhedron> poly,
+                                 shared_ptr<const PolyhedronLod> lod)
+    : animation_(animation), poly_(poly), lodSource_(lod) {
+    lod_ = lod ? lod : make_shared<const PolyhedronLod>(fullDetailLod(*poly));
+
+    size_t points = 0;
+    for (const LodChain& chain : lod_->shells) {
+        offsets_.push_back(points);
+        points += chain.levels[0].vertices.size();
+    }
+    for (AnimationFrame& frame : frames_) {
+        frame.levels.assign(lod_->shells.size(), 0);
+        frame.points.resize(points);
+        frame.edges = 0;
+    }
+    worker_ = thread(&AnimationPlayer::work, this);
+}
+
+AnimationPlayer::~AnimationPlayer() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+        wake_.notify_all();
+    }
+    worker_.join();
+}
+
+void AnimationPlayer::request(double t, const double view[2][3], size_t edgeBudget) {
+    lock_guard<mutex> lock(mutex_);
+    time_ = t;
+    for (int r = 0; r < 2; ++r) {
+        for (int k = 0; k < 3; ++k) view_[r][k] = view[r][k];
+    }
+    edgeBudget_ = edgeBudget;
+    requested_ = true;
+    pending_ = true;
+    wake_.notify_all();
+}
+
+const AnimationFrame& AnimationPlayer::take() {
+    unique_lock<mutex> lock(mutex_);
+    wake_.wait(lock, [this] { return !pending_; });
+    front_ = 1 - front_;
+    return frames_[front_];
+}
+
+void AnimationPlayer::work() {
+    while (true) {
+        double t, view[2][3];
+        size_t edgeBudget;
+        AnimationFrame* back;
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || requested_; });
+            if (stopping_) return;
+            requested_ = false;
+            t = time_;
+            for (int r = 0; r < 2; ++r) {
+                for (int k = 0; k < 3; ++k) view[r][k] = view_[r][k];
+            }
+            edgeBudget = edgeBudget_;
+            back = &frames_[1 - front_];
+        }
+
+        project(t, view, edgeBudget, *back);
+
+        lock_guard<mutex> lock(mutex_);
+        pending_ = requested_;  // A newer request is still to come
+        wake_.notify_all();
+    }
+}
+
+// As in UiHost::drawScene, the pose is folded into the view matrix so each
+// vertex costs one 2x3 product
+void AnimationPlayer::project(double t, const double view[2][3], size_t edgeBudget, AnimationFrame& frame) const {
+    AffineMap pose = animation_->poseAt(t);
+    double M[2][3], offset[2];
+    double pixelsPerUnit = 0;
+    for (int r = 0; r < 2; ++r) {
+        offset[r] = (r == 0 ? SCREEN_WIDTH : SCREEN_HEIGHT) / 2;
+        for (int k = 0; k < 3; ++k) {
+            M[r][k] = view[r][0] * pose.linear(0, k) + view[r][1] * pose.linear(1, k) + view[r][2] * pose.linear(2, k);
+            offset[r] += view[r][k] * pose.translation(k);
+        }
+        pixelsPerUnit = max(pixelsPerUnit, sqrt(M[r][0] * M[r][0] + M[r][1] * M[r][1] + M[r][2] * M[r][2]));
+    }
+
+    frame.edges = 0;
+    for (size_t s = 0; s < lod_->shells.size(); ++s) {
+        const LodChain& chain = lod_->shells[s];
+        size_t budget = numeric_limits<size_t>::max();
+        if (edgeBudget != numeric_limits<size_t>::max()) {
+            double share = static_cast<double>(chain.levels[0].edges.size() / 2) / max<size_t>(lod_->fullEdges, 1);
+            budget = static_cast<size_t>(edgeBudget * share);
+        }
+        int level = pickLodLevel(chain, pixelsPerUnit, LOD_PIXEL_TOLERANCE, budget);
+        const LodLevel& shown = chain.levels[level];
+        SDL_Point* out = frame.points.data() + offsets_[s];
+        for (size_t i = 0; i < shown.vertices.size(); ++i) {
+            const Vertex& v = shown.vertices[i];
+            out[i].x = static_cast<int>(M[0][0] * v.x + M[0][1] * v.y + M[0][2] * v.z + offset[0]);
+            out[i].y = static_cast<int>(M[1][0] * v.x + M[1][1] * v.y + M[1][2] * v.z + offset[1]);
+        }
+        frame.levels[s] = level;
+        frame.edges += shown.edges.size() / 2;
+    }
+}
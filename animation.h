@@ -0,0 +1,99 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "scene.h"
+#include "history.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct PolyhedronLod;
+
+struct Keyframe {
+    double time;      // Seconds from the start of the animation
+    AffineMap pose;
+};
+
+// The pose of the part at any time between keyframes. Each pose's linear part
+// is split into a proper rotation and a symmetric stretch (polar
+// decomposition). Rotations are slerped as quaternions; stretches and
+// translations are interpolated linearly. A reflection is a stretch with a
+// negative axis, so a mirror flip plays as the part folding flat and opening
+// out reversed.
+class Animation {
+public:
+    // Sorted by time; needs at least one keyframe
+    explicit Animation(vector<Keyframe> keyframes);
+
+    double duration() const { return keyframes_.back().time; }
+    // Wraps t into [0, duration], so the animation loops
+    AffineMap poseAt(double t) const;
+
+private:
+    struct PoseParts {
+        Quaternion<double, DontAlign> rotation;
+        Matrix3d stretch;
+        Vector3d translation;
+    };
+
+    vector<Keyframe> keyframes_;
+    vector<PoseParts> parts_;
+};
+
+// Map applied by one step of the transformation menu
+AffineMap transformOpMap(const TransformOp& op);
+
+// One projected frame: each shell's level of detail and its screen points
+struct AnimationFrame {
+    vector<int> levels;            // Level drawn for each shell of the lod
+    vector<SDL_Point> points;      // Each shell's points start at the player's shellOffset
+    size_t edges;
+};
+
+// Projects the animated part for the viewer on its own thread, one frame
+// ahead: while the SDL thread draws the frame returned by take(), the worker
+// fills the other buffer for the next display time. Both buffers are sized
+// for full detail up front, so no frame allocates.
+class AnimationPlayer {
+public:
+    AnimationPlayer(shared_ptr<const Animation> animation, shared_ptr<const Polyhedron> poly,
+                    shared_ptr<const PolyhedronLod> lod);
+    ~AnimationPlayer();
+
+    const Animation* animation() const { return animation_.get(); }
+    const Polyhedron* source() const { return poly_.get(); }
+    const PolyhedronLod* lod() const { return lodSource_.get(); }
+    const PolyhedronLod& levels() const { return *lod_; }
+    size_t shellOffset(size_t shell) const { return offsets_[shell]; }
+
+    // Starts projecting the pose at `t` seconds through `view` into the back
+    // buffer, at the coarsest levels that fit `edgeBudget`
+    void request(double t, const double view[2][3], size_t edgeBudget);
+    // Waits for the last request and returns it; valid until the next take()
+    const AnimationFrame& take();
+
+private:
+    void work();
+    void project(double t, const double view[2][3], size_t edgeBudget, AnimationFrame& frame) const;
+
+    shared_ptr<const Animation> animation_;
+    shared_ptr<const Polyhedron> poly_;
+    shared_ptr<const PolyhedronLod> lodSource_;  // As passed in, to notice a newer one
+    shared_ptr<const PolyhedronLod> lod_;        // Or level 0 only when none was passed
+    vector<size_t> offsets_;
+
+    mutex mutex_;
+    condition_variable wake_;
+    thread worker_;
+    AnimationFrame frames_[2];
+    int front_ = 0;                // Returned by take(); the worker writes the other one
+    bool pending_ = false;         // A request the worker has not finished
+    bool requested_ = false;       // A request the worker has not started
+    bool stopping_ = false;
+    double time_ = 0;
+    double view_[2][3];
+    size_t edgeBudget_ = 0;
+};
+
+#endif
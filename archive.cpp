@@ -0,0 +1,435 @@
+#include "archive.h"
+#include "facemesh.h"
+#include "geometry.h"
+
+#include <chrono>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char ARCHIVE_MAGIC[8] = {'P', 'O', 'L', 'Y', 'A', 'R', 'C', '1'};
+
+static void putVarint(vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void putDouble(vector<uint8_t>& out, double value) {
+    uint8_t bytes[8];
+    memcpy(bytes, &value, sizeof(bytes));
+    out.insert(out.end(), bytes, bytes + 8);
+}
+
+// Small magnitudes of either sign become small codes: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t code) {
+    return static_cast<int64_t>(code >> 1) ^ -static_cast<int64_t>(code & 1);
+}
+
+// Bounds-checked cursor over a record; any overrun clears `ok` and yields zeros
+struct ByteReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    ByteReader(const uint8_t* data, size_t size) : p(data), end(data + size), ok(true) {}
+
+    uint64_t varint() {
+        if (p < end && *p < 0x80) return *p++;  // Most deltas and arities fit one byte
+        uint64_t value = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    double real() {
+        double value = 0;
+        if (end - p < 8) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, p, sizeof(value));
+        p += 8;
+        return value;
+    }
+
+    uint8_t byte() {
+        if (p == end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+};
+
+// Quantization grid of one shell: coordinate = lo + q * step for q in [0, 2^bits - 1]
+struct Grid {
+    double lo[3], step[3];
+};
+
+// Half the diagonal of a grid cell: the furthest rounding moves a vertex
+static double gridDisplacement(const Grid& grid) {
+    return 0.5 * sqrt(grid.step[0] * grid.step[0] + grid.step[1] * grid.step[1] + grid.step[2] * grid.step[2]);
+}
+
+static void encodeShell(const Polyhedron& shell, int depth, int bits, vector<uint8_t>& out, double& volumeBound) {
+    // Number vertices in order of first use so decoding fills them front to back
+    size_t n = shell.vertices.size();
+    vector<int> newIndex(n, -1), order;
+    order.reserve(n);
+    for (const Face& face : shell.faces) {
+        for (const Edge& edge : face.edges) {
+            if (newIndex[edge.i1] < 0) {
+                newIndex[edge.i1] = static_cast<int>(order.size());
+                order.push_back(edge.i1);
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (newIndex[i] < 0) {
+            newIndex[i] = static_cast<int>(order.size());
+            order.push_back(static_cast<int>(i));
+        }
+    }
+
+    Grid grid;
+    double hi[3];
+    for (int k = 0; k < 3; ++k) {
+        grid.lo[k] = n ? numeric_limits<double>::max() : 0;
+        hi[k] = n ? -numeric_limits<double>::max() : 0;
+    }
+    for (const Vertex& v : shell.vertices) {
+        const double c[3] = {v.x, v.y, v.z};
+        for (int k = 0; k < 3; ++k) {
+            grid.lo[k] = min(grid.lo[k], c[k]);
+            hi[k] = max(hi[k], c[k]);
+        }
+    }
+    const uint64_t maxQ = (bits >= 32 ? 0xFFFFFFFFull : (1ull << bits) - 1);
+    for (int k = 0; k < 3; ++k) grid.step[k] = (hi[k] - grid.lo[k]) / maxQ;
+
+    putVarint(out, depth);
+    for (int k = 0; k < 3; ++k) putDouble(out, grid.lo[k]);
+    for (int k = 0; k < 3; ++k) putDouble(out, grid.step[k]);
+    putVarint(out, n);
+    putVarint(out, shell.faces.size());
+
+    int64_t previous[3] = {0, 0, 0};
+    for (int i : order) {
+        const Vertex& v = shell.vertices[i];
+        const double c[3] = {v.x, v.y, v.z};
+        for (int k = 0; k < 3; ++k) {
+            int64_t q = grid.step[k] > 0 ? llround((c[k] - grid.lo[k]) / grid.step[k]) : 0;
+            q = min<int64_t>(max<int64_t>(q, 0), maxQ);
+            putVarint(out, zigzag(q - previous[k]));
+            previous[k] = q;
+        }
+    }
+
+    // The tube bound needs the area, the edge length (every face edge, so
+    // shared edges count twice and open shells stay covered) and the vertex count
+    double area = 0, edgeLength = 0;
+    int64_t last = 0;
+    vector<int> loop;
+    for (const Face& face : shell.faces) {
+        loop.clear();
+        for (const Edge& edge : face.edges) loop.push_back(edge.i1);
+        putVarint(out, loop.size());
+        for (int i : loop) {
+            putVarint(out, zigzag(newIndex[i] - last));
+            last = newIndex[i];
+        }
+        if (loop.size() >= 3) {
+            Vertex a = faceVectorArea<0>(shell.vertices.data(), loop.data(), static_cast<int>(loop.size()));
+            area += sqrt(a.x * a.x + a.y * a.y + a.z * a.z) / 2.0;
+        }
+        for (size_t j = 0; j < loop.size(); ++j) {
+            const Vertex& p = shell.vertices[loop[j]];
+            const Vertex& q = shell.vertices[loop[(j + 1) % loop.size()]];
+            edgeLength += sqrt((q.x - p.x) * (q.x - p.x) + (q.y - p.y) * (q.y - p.y) + (q.z - p.z) * (q.z - p.z));
+        }
+    }
+    double delta = gridDisplacement(grid);
+    volumeBound += 2 * delta * area + M_PI * delta * delta * edgeLength + 4.0 / 3.0 * M_PI * delta * delta * delta * n;
+}
+
+static void encodeShells(const Polyhedron& poly, int depth, int bits, vector<uint8_t>& out, double& volumeBound, size_t& count) {
+    encodeShell(poly, depth, bits, out, volumeBound);
+    ++count;
+    for (const Polyhedron& hole : poly.sub_polyhedrons) {
+        encodeShells(hole, depth + 1, bits, out, volumeBound, count);
+    }
+}
+
+void encodeArchivePart(const string& name, const Polyhedron& poly, int bits, vector<uint8_t>& out) {
+    bits = min(max(bits, 1), 32);
+    vector<uint8_t> sections;
+    double volumeBound = 0;
+    size_t count = 0;
+    encodeShells(poly, 0, bits, sections, volumeBound, count);
+
+    putVarint(out, name.size());
+    out.insert(out.end(), name.begin(), name.end());
+    out.push_back(static_cast<uint8_t>(bits));
+    putDouble(out, volumeBound);
+    putVarint(out, count);
+    out.insert(out.end(), sections.begin(), sections.end());
+}
+
+static bool decodeShell(ByteReader& in, int bits, Polyhedron& shell, Grid& grid) {
+    for (int k = 0; k < 3; ++k) grid.lo[k] = in.real();
+    for (int k = 0; k < 3; ++k) grid.step[k] = in.real();
+    uint64_t numVertices = in.varint();
+    uint64_t numFaces = in.varint();
+    // Every vertex takes at least three bytes and every face at least one
+    if (!in.ok || numVertices > static_cast<uint64_t>(in.end - in.p) / 3 || numFaces > static_cast<uint64_t>(in.end - in.p)) {
+        return false;
+    }
+
+    // Undo the deltas first, then scale in a separate branch-free loop the
+    // compiler can vectorise
+    const int64_t maxQ = bits >= 32 ? 0xFFFFFFFFll : (1ll << bits) - 1;
+    vector<uint32_t> q(3 * numVertices);
+    int64_t previous[3] = {0, 0, 0};
+    for (size_t i = 0; i < numVertices; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            previous[k] += unzigzag(in.varint());
+            if (previous[k] < 0 || previous[k] > maxQ) return false;
+            q[3 * i + k] = static_cast<uint32_t>(previous[k]);
+        }
+    }
+    if (!in.ok) return false;
+    shell.vertices.resize(numVertices);
+    Vertex* vertices = shell.vertices.data();
+    for (size_t i = 0; i < numVertices; ++i) {
+        vertices[i].x = grid.lo[0] + q[3 * i] * grid.step[0];
+        vertices[i].y = grid.lo[1] + q[3 * i + 1] * grid.step[1];
+        vertices[i].z = grid.lo[2] + q[3 * i + 2] * grid.step[2];
+    }
+
+    shell.faces.resize(numFaces);
+    int64_t last = 0;
+    for (Face& face : shell.faces) {
+        uint64_t arity = in.varint();
+        if (!in.ok || arity > static_cast<uint64_t>(in.end - in.p)) return false;
+        face.num_edges = static_cast<int>(arity);
+        face.edges.resize(arity);
+        for (Edge& edge : face.edges) {
+            last += unzigzag(in.varint());
+            if (last < 0 || last >= static_cast<int64_t>(numVertices)) return false;
+            edge.i1 = static_cast<int>(last);
+        }
+        for (size_t j = 0; j < arity; ++j) {
+            Edge& edge = face.edges[j];
+            edge.i2 = face.edges[j + 1 < arity ? j + 1 : 0].i1;
+            edge.v1 = vertices[edge.i1];
+            edge.v2 = vertices[edge.i2];
+            double dx = edge.v2.x - edge.v1.x, dy = edge.v2.y - edge.v1.y, dz = edge.v2.z - edge.v1.z;
+            edge.length = sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+    return in.ok;
+}
+
+bool decodeArchivePart(const uint8_t* data, size_t size, ArchivePart& part) {
+    ByteReader in(data, size);
+    uint64_t nameLength = in.varint();
+    if (!in.ok || nameLength > static_cast<uint64_t>(in.end - in.p)) return false;
+    part.name.assign(reinterpret_cast<const char*>(in.p), nameLength);
+    in.p += nameLength;
+    part.bits = in.byte();
+    part.volumeBound = in.real();
+    uint64_t numShells = in.varint();
+    if (!in.ok || part.bits < 1 || part.bits > 32 || numShells == 0) return false;
+
+    // Sections come depth-first, so the open ancestors of the next shell are a stack
+    part.poly = Polyhedron();
+    vector<Polyhedron*> open;
+    for (uint64_t s = 0; s < numShells; ++s) {
+        uint64_t depth = in.varint();
+        if (!in.ok || (s == 0) != (depth == 0) || depth > open.size()) return false;
+        Polyhedron* shell = &part.poly;
+        if (s > 0) {
+            open.resize(depth);
+            open.back()->sub_polyhedrons.emplace_back();
+            shell = &open.back()->sub_polyhedrons.back();
+        }
+        open.push_back(shell);
+
+        Grid grid;
+        if (!decodeShell(in, part.bits, *shell, grid)) return false;
+        if (s == 0) {
+            part.maxDisplacement = gridDisplacement(grid);
+            const uint64_t maxQ = part.bits >= 32 ? 0xFFFFFFFFull : (1ull << part.bits) - 1;
+            part.lo = {grid.lo[0], grid.lo[1], grid.lo[2]};
+            part.hi = {grid.lo[0] + maxQ * grid.step[0], grid.lo[1] + maxQ * grid.step[1], grid.lo[2] + maxQ * grid.step[2]};
+        }
+    }
+    return in.ok;
+}
+
+double volumeErrorBound(const ArchivePart& part) {
+    return part.volumeBound;
+}
+
+double inertiaErrorBound(const ArchivePart& part, const Vertex& origin, double density) {
+    // Every integrand of the tensor (y^2 + z^2, -xy, ...) is at most R^2 in size
+    double d = part.maxDisplacement, r2 = 0;
+    const double lo[3] = {part.lo.x - d - origin.x, part.lo.y - d - origin.y, part.lo.z - d - origin.z};
+    const double hi[3] = {part.hi.x + d - origin.x, part.hi.y + d - origin.y, part.hi.z + d - origin.z};
+    for (int k = 0; k < 3; ++k) r2 += max(lo[k] * lo[k], hi[k] * hi[k]);
+    return fabs(density) * part.volumeBound * r2;
+}
+
+bool ArchiveWriter::open(const string& path) {
+    close();
+    bool fresh = true;
+    if (FILE* existing = fopen(path.c_str(), "rb")) {
+        char magic[8];
+        size_t got = fread(magic, 1, sizeof(magic), existing);
+        fclose(existing);
+        if (got == sizeof(magic) && memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0) return false;
+        fresh = got == 0;
+        if (got != 0 && got != sizeof(magic)) return false;
+    }
+    file_ = fopen(path.c_str(), "ab");
+    if (!file_) return false;
+    if (fresh && fwrite(ARCHIVE_MAGIC, 1, sizeof(ARCHIVE_MAGIC), file_) != sizeof(ARCHIVE_MAGIC)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveWriter::add(const string& name, const Polyhedron& poly, int bits) {
+    if (!file_) return false;
+    vector<uint8_t> payload;
+    encodeArchivePart(name, poly, bits, payload);
+    buffer_.clear();
+    putVarint(buffer_, payload.size());
+    buffer_.insert(buffer_.end(), payload.begin(), payload.end());
+    return fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+}
+
+void ArchiveWriter::close() {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+}
+
+bool ArchiveReader::open(const string& path) {
+    close();
+    damaged_ = false;
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) return false;
+    struct stat info;
+    if (fstat(fileno(file_), &info) != 0) {
+        close();
+        return false;
+    }
+    fileSize_ = static_cast<uint64_t>(info.st_size);
+    char magic[8];
+    if (fread(magic, 1, sizeof(magic), file_) != sizeof(magic) || memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// The varint length in front of every record. Running out of file before
+// its first byte is the end of the archive; anything else wrong with it,
+// including a length past the end of the file, marks the record damaged.
+bool ArchiveReader::readRecordSize(uint64_t& size) {
+    damaged_ = false;
+    if (!file_) return false;
+    size = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(file_);
+        if (c == EOF) {
+            damaged_ = shift > 0 || ferror(file_);
+            return false;
+        }
+        size |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            off_t at = ftello(file_);
+            damaged_ = at < 0 || size > fileSize_ - static_cast<uint64_t>(at);
+            return !damaged_;
+        }
+    }
+    damaged_ = true;
+    return false;
+}
+
+bool ArchiveReader::readRecord() {
+    uint64_t size;
+    if (!readRecordSize(size)) return false;
+    buffer_.resize(size);
+    damaged_ = fread(buffer_.data(), 1, size, file_) != size;
+    return !damaged_;
+}
+
+bool ArchiveReader::next(ArchivePart& part) {
+    if (!readRecord()) return false;
+    damaged_ = !decodeArchivePart(buffer_.data(), buffer_.size(), part);
+    return !damaged_;
+}
+
+bool ArchiveReader::skip() {
+    uint64_t size;
+    if (!readRecordSize(size)) return false;
+    damaged_ = fseeko(file_, static_cast<off_t>(size), SEEK_CUR) != 0;
+    return !damaged_;
+}
+
+void ArchiveReader::close() {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+}
+
+int scanArchive(const string& path, const Vertex& origin, double density) {
+    ArchiveReader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "Could not open part archive %s\n", path.c_str());
+        return 1;
+    }
+
+    ArchivePart part;
+    size_t parts = 0, faces = 0;
+    double decodeSeconds = 0;
+    while (true) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (!reader.next(part)) break;
+        decodeSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        size_t partFaces = 0, shells = 0;
+        vector<const Polyhedron*> pending(1, &part.poly);
+        while (!pending.empty()) {
+            const Polyhedron* shell = pending.back();
+            pending.pop_back();
+            partFaces += shell->faces.size();
+            ++shells;
+            for (const Polyhedron& hole : shell->sub_polyhedrons) pending.push_back(&hole);
+        }
+        MassProperties props = computeMassProperties(part.poly, origin, density);
+        printf("%s: %zu shell(s), %zu faces, %d bits, volume %.6g +/- %.3g, Ixx %.6g +/- %.3g\n", part.name.c_str(),
+               shells, partFaces, part.bits, props.volume, volumeErrorBound(part), props.inertia.Ixx,
+               inertiaErrorBound(part, origin, density));
+        ++parts;
+        faces += partFaces;
+    }
+    printf("%zu part(s), %zu faces decoded in %.3f s\n", parts, faces, decodeSeconds);
+    if (reader.damaged()) {
+        fprintf(stderr, "Part %zu of %s is damaged; the parts after it were not read\n", parts + 1, path.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "input.h"
+
+#include <cstdint>
+
+// Part library file: an 8-byte magic followed by one length-prefixed record
+// per part, so a scan can skip parts without decoding them.
+//
+// A record holds the part's name and one section per shell, outer shell
+// first and then holes depth-first, each tagged with its nesting depth.
+// Vertices are quantized on a grid spanning the shell's bounding box with
+// 2^bits - 1 steps per axis and stored as zigzag varint deltas from the
+// previous vertex, renumbered in order of first use by the faces so the
+// index deltas stay small and decoding writes memory front to back. Faces are
+// stored as their Edge::i1 loops: a varint arity, then varint index deltas.
+// Edges are rebuilt from the loops on decoding.
+//
+// Rounding moves no vertex by more than half the grid cell diagonal, delta.
+// The decoded surface then stays within delta of the original, so the two
+// solids differ only inside that tube around the surface. Its volume is at most
+// 2 delta A + pi delta^2 L + 4/3 pi delta^3 N per shell, with A the area,
+// L the total edge length and N the vertex count. That sum bounds the change
+// in volume. Each inertia component changes by at most density * that bound
+// * R^2, where R reaches the farthest point of the part's box grown by delta.
+
+const int ARCHIVE_DEFAULT_BITS = 16;
+
+struct ArchivePart {
+    string name;
+    Polyhedron poly;
+    int bits;
+    double maxDisplacement;  // delta of the outer shell; holes use their own, finer grids
+    double volumeBound;      // Largest possible change in volume, all shells
+    Vertex lo, hi;           // Bounding box of the decoded outer shell
+};
+
+// Appends one encoded part (bits from 1 to 32) to `out`
+void encodeArchivePart(const string& name, const Polyhedron& poly, int bits, vector<uint8_t>& out);
+// False if the record is damaged or truncated
+bool decodeArchivePart(const uint8_t* data, size_t size, ArchivePart& part);
+
+double volumeErrorBound(const ArchivePart& part);
+// Bound on the change of every component of the inertia tensor about `origin`
+double inertiaErrorBound(const ArchivePart& part, const Vertex& origin, double density);
+
+class ArchiveWriter {
+public:
+    ArchiveWriter() : file_(nullptr) {}
+    ~ArchiveWriter() { close(); }
+
+    bool open(const string& path);  // Appends to an existing archive, or creates one
+    bool add(const string& name, const Polyhedron& poly, int bits = ARCHIVE_DEFAULT_BITS);
+    void close();
+
+private:
+    FILE* file_;
+    vector<uint8_t> buffer_;
+};
+
+// Reads one record at a time into a reused buffer, so memory stays at the
+// size of the largest part however long the archive is
+class ArchiveReader {
+public:
+    ArchiveReader() : file_(nullptr), fileSize_(0), damaged_(false) {}
+    ~ArchiveReader() { close(); }
+
+    bool open(const string& path);
+    bool next(ArchivePart& part);  // False at the end of the archive or on a damaged record
+    bool skip();                   // Steps over the next part without decoding it
+    void close();
+
+    // The last next() or skip() failed on a damaged record, not at the end
+    bool damaged() const { return damaged_; }
+
+private:
+    bool readRecordSize(uint64_t& size);
+    bool readRecord();
+
+    FILE* file_;
+    uint64_t fileSize_;
+    bool damaged_;
+    vector<uint8_t> buffer_;
+};
+
+// Decodes every part of the archive and prints its volume and Ixx with their
+// quantization bounds; returns a process exit code
+int scanArchive(const string& path, const Vertex& origin, double density);
+
+#endif
@@ -0,0 +1,314 @@
+#include "cache.h"
+#include "facemesh.h"
+#include "geometry.h"
+#include "scheduler.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char CACHE_MAGIC[8] = {'P', 'O', 'L', 'Y', 'C', 'A', 'C', '2'};
+static const size_t CACHE_INITIAL_CAPACITY = 1024; // Must be a power of two
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t count;
+};
+
+// Helper function to fold 64-bit words into a running hash (multiply-xorshift)
+static void hashWord(uint64_t& h, uint64_t word) {
+    h ^= word + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+}
+
+static void hashDouble(uint64_t& h, double value) {
+    if (value == 0.0) value = 0.0; // Folds -0.0 into 0.0
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    hashWord(h, bits);
+}
+
+static void hashShell(uint64_t& h, const Polyhedron& poly) {
+    hashWord(h, poly.vertices.size());
+    for (const Vertex& v : poly.vertices) {
+        hashDouble(h, v.x);
+        hashDouble(h, v.y);
+        hashDouble(h, v.z);
+    }
+
+    hashWord(h, poly.faces.size());
+    for (const Face& face : poly.faces) {
+        size_t n = face.edges.size();
+        size_t first = 0;
+        for (size_t j = 1; j < n; ++j) {
+            if (face.edges[j].i1 < face.edges[first].i1) first = j;
+        }
+        hashWord(h, n);
+        for (size_t j = 0; j < n; ++j) {
+            hashWord(h, static_cast<uint64_t>(face.edges[(first + j) % n].i1));
+        }
+    }
+
+    hashWord(h, poly.sub_polyhedrons.size());
+    for (const Polyhedron& sub : poly.sub_polyhedrons) {
+        hashShell(h, sub);
+    }
+}
+
+uint64_t hashPolyhedron(const Polyhedron& poly, const Vertex& origin, double density) {
+    uint64_t h = 0x243F6A8885A308D3ULL;
+    hashDouble(h, origin.x);
+    hashDouble(h, origin.y);
+    hashDouble(h, origin.z);
+    hashDouble(h, density);
+    hashShell(h, poly);
+    return h ? h : 1; // 0 marks an empty slot
+}
+
+// Holds an exclusive flock for its lifetime; a no-op on a closed descriptor
+struct FileLock {
+    explicit FileLock(int fd) : fd_(fd) {
+        if (fd_ >= 0) while (flock(fd_, LOCK_EX) != 0 && errno == EINTR) {}
+    }
+    ~FileLock() {
+        if (fd_ >= 0) flock(fd_, LOCK_UN);
+    }
+    int fd_;
+};
+
+ResultCache::ResultCache()
+    : fd_(-1), lockFd_(-1), mapping_(nullptr), mappingSize_(0), header_(nullptr), records_(nullptr) {}
+
+ResultCache::~ResultCache() {
+    unmap();
+    if (lockFd_ >= 0) close(lockFd_);
+}
+
+void ResultCache::unmap() {
+    if (mapping_) munmap(mapping_, mappingSize_);
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+    mapping_ = nullptr;
+    header_ = nullptr;
+    records_ = nullptr;
+}
+
+// Maps path_ with room for `capacity` records, writing a fresh header if `create`
+bool ResultCache::map(size_t capacity, bool create) {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) return false;
+
+    mappingSize_ = sizeof(CacheHeader) + capacity * sizeof(AnalysisRecord);
+    if (create && ftruncate(fd_, 0) != 0) {
+        unmap();
+        return false;
+    }
+    if (ftruncate(fd_, mappingSize_) != 0) {
+        unmap();
+        return false;
+    }
+    mapping_ = mmap(nullptr, mappingSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        unmap();
+        return false;
+    }
+    header_ = static_cast<CacheHeader*>(mapping_);
+    records_ = reinterpret_cast<AnalysisRecord*>(static_cast<char*>(mapping_) + sizeof(CacheHeader));
+    if (create) {
+        memcpy(header_->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header_->recordSize = sizeof(AnalysisRecord);
+        header_->reserved = 0;
+        header_->capacity = capacity;
+        header_->count = 0;
+    }
+    return true;
+}
+
+// Maps path_, reusing the file only if its header matches this build's record
+// layout; the caller holds the file lock
+bool ResultCache::attach() {
+    CacheHeader existing;
+    bool compatible = false;
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (read(fd, &existing, sizeof(existing)) == static_cast<ssize_t>(sizeof(existing)) &&
+            fstat(fd, &info) == 0 &&
+            memcmp(existing.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+            existing.recordSize == sizeof(AnalysisRecord) &&
+            existing.capacity >= CACHE_INITIAL_CAPACITY &&
+            (existing.capacity & (existing.capacity - 1)) == 0 &&
+            static_cast<uint64_t>(info.st_size) == sizeof(CacheHeader) + existing.capacity * sizeof(AnalysisRecord)) {
+            compatible = true;
+        }
+        close(fd);
+    }
+
+    if (compatible) return map(existing.capacity, false);
+    return map(CACHE_INITIAL_CAPACITY, true);
+}
+
+// True if another process has grown the table (renamed a new file over
+// path_) or resized it since this mapping was made
+bool ResultCache::replaced() const {
+    struct stat mapped, current;
+    if (fstat(fd_, &mapped) != 0 || stat(path_.c_str(), &current) != 0) return true;
+    return mapped.st_dev != current.st_dev || mapped.st_ino != current.st_ino ||
+           static_cast<size_t>(current.st_size) != mappingSize_;
+}
+
+bool ResultCache::open(const string& path) {
+    lock_guard<mutex> lock(mutex_);
+    unmap();
+    if (lockFd_ >= 0) close(lockFd_);
+    path_ = path;
+
+    lockFd_ = ::open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if (lockFd_ < 0) return false;
+    FileLock fileLock(lockFd_);
+    return attach();
+}
+
+// Linear probing; returns the slot holding `key` or the empty slot where it belongs
+AnalysisRecord* ResultCache::findSlot(uint64_t key) {
+    size_t mask = header_->capacity - 1;
+    for (size_t i = key & mask;; i = (i + 1) & mask) {
+        if (records_[i].key == key || records_[i].key == 0) return &records_[i];
+    }
+}
+
+bool ResultCache::lookup(uint64_t key, AnalysisRecord& record) {
+    lock_guard<mutex> lock(mutex_);
+    if (!records_) return false;
+    AnalysisRecord* slot = findSlot(key);
+    if (slot->key != key) return false;
+    record = *slot;
+    return true;
+}
+
+// Rehash into a file twice the size, then atomically replace the old one.
+// The caller holds the file lock, so no other process writes meanwhile.
+bool ResultCache::grow() {
+    vector<AnalysisRecord> live;
+    live.reserve(header_->count);
+    for (size_t i = 0; i < header_->capacity; ++i) {
+        if (records_[i].key != 0) live.push_back(records_[i]);
+    }
+    size_t capacity = header_->capacity * 2;
+    string finalPath = path_;
+
+    unmap();
+    path_ = finalPath + ".tmp";
+    if (!map(capacity, true)) {
+        path_ = finalPath;
+        return false;
+    }
+    for (const auto& record : live) {
+        *findSlot(record.key) = record;
+    }
+    header_->count = live.size();
+    msync(mapping_, mappingSize_, MS_SYNC);
+    bool renamed = rename(path_.c_str(), finalPath.c_str()) == 0;
+    path_ = finalPath;
+    return renamed;
+}
+
+void ResultCache::store(const AnalysisRecord& record) {
+    lock_guard<mutex> lock(mutex_);
+    if (!records_ || record.key == 0) return;
+
+    // Another process may have grown the table while this one waited
+    FileLock fileLock(lockFd_);
+    if (replaced()) {
+        unmap();
+        if (!attach()) return;
+    }
+
+    AnalysisRecord* slot = findSlot(record.key);
+    if (slot->key == 0) {
+        // Keep the load factor at or below one half so probes stay short
+        if ((header_->count + 1) * 2 > header_->capacity) {
+            if (!grow()) {
+                unmap();
+                return;
+            }
+            slot = findSlot(record.key);
+        }
+        AnalysisRecord fresh = AnalysisRecord();
+        fresh.key = 0;
+        *slot = fresh;
+        header_->count++;
+    }
+
+    // Merge only the fields this record carries, then publish the key last
+    AnalysisRecord merged = *slot;
+    if (record.flags & CACHE_VALIDATED) {
+        merged.flags = (merged.flags & ~(CACHE_VALIDATED | CACHE_VALID)) | (record.flags & (CACHE_VALIDATED | CACHE_VALID));
+    }
+    if (record.flags & CACHE_SURFACE_AREA) merged.surfaceArea = record.surfaceArea;
+    if (record.flags & CACHE_VOLUME) merged.volume = record.volume;
+    if (record.flags & CACHE_CENTER_OF_MASS) merged.centerOfMass = record.centerOfMass;
+    if (record.flags & CACHE_INERTIA) merged.inertia = record.inertia;
+    merged.flags |= record.flags & (CACHE_SURFACE_AREA | CACHE_VOLUME | CACHE_CENTER_OF_MASS | CACHE_INERTIA);
+    merged.key = 0;
+    *slot = merged;
+    slot->key = record.key;
+}
+
+AnalysisRecord analysePolyhedron(const Polyhedron& poly, const Vertex& origin, double density,
+                                 ResultCache* cache, uint32_t wanted, TaskState* state) {
+    AnalysisRecord record = AnalysisRecord();
+    record.key = hashPolyhedron(poly, origin, density);
+    if (cache && cache->lookup(record.key, record) && (record.flags & wanted) == wanted) {
+        return record;
+    }
+
+    static const uint32_t steps[] = {CACHE_SURFACE_AREA, CACHE_VOLUME, CACHE_CENTER_OF_MASS, CACHE_INERTIA};
+    uint32_t missing = wanted & ~record.flags;
+    int numMissing = 0, done = 0;
+    for (uint32_t step : steps) {
+        if (missing & step) numMissing++;
+    }
+
+    // Faces are grouped by arity once; volume, centre of mass and inertia
+    // all come from the same integrals, so that pass also runs at most once
+    FaceMesh mesh;
+    if (missing) mesh = buildFaceMesh(poly);
+    VolumeIntegrals sums;
+    bool integrated = false;
+
+    // The kernels check for cancellation and report progress every few
+    // thousand faces, each pass within its step's share of the task
+    for (uint32_t step : steps) {
+        if (!(missing & step)) continue;
+        if (state) state->checkCancelled();
+        double from = static_cast<double>(done) / numMissing, to = static_cast<double>(done + 1) / numMissing;
+        if (step != CACHE_SURFACE_AREA && !integrated) {
+            KernelProgress progress(state, meshFaceCount(mesh), from, to);
+            accumulateMeshIntegrals(mesh, origin, sums, &progress);
+            integrated = true;
+        }
+        if (step == CACHE_SURFACE_AREA) {
+            KernelProgress progress(state, mesh.triangles.size() + mesh.quads.size() + mesh.polygons.size(), from, to);
+            record.surfaceArea = meshSurfaceArea(mesh, &progress);
+        }
+        if (step == CACHE_VOLUME) record.volume = sums.volume;
+        if (step == CACHE_CENTER_OF_MASS) record.centerOfMass = centerOfMassFromIntegrals(sums, origin);
+        if (step == CACHE_INERTIA) record.inertia = inertiaFromIntegrals(sums, density);
+        record.flags |= step;
+        if (state) state->setProgress(static_cast<double>(++done) / numMissing);
+    }
+
+    if (cache) cache->store(record);
+    return record;
+}
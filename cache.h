@@ -0,0 +1,81 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "input.h"
+
+#include <cstdint>
+#include <mutex>
+
+// Which fields of an AnalysisRecord hold real values
+enum CacheFlags : uint32_t {
+    CACHE_VALIDATED = 1u << 0,
+    CACHE_VALID = 1u << 1,          // Meaningful only together with CACHE_VALIDATED
+    CACHE_SURFACE_AREA = 1u << 2,
+    CACHE_VOLUME = 1u << 3,
+    CACHE_CENTER_OF_MASS = 1u << 4,
+    CACHE_INERTIA = 1u << 5
+};
+
+// One fixed-size slot of the on-disk table; key 0 marks an empty slot
+struct AnalysisRecord {
+    uint64_t key;
+    uint32_t flags;
+    float surfaceArea;
+    double volume;
+    Vertex centerOfMass;
+    InertiaTensor inertia;
+};
+
+// Content hash of the geometry and of everything the results depend on.
+// Vertices are hashed by value (with -0.0 folded into 0.0), each face loop is
+// rotated to start at its smallest vertex index, and holes are hashed
+// recursively with their nesting, so re-entering the same part in a
+// different face starting order gives the same key.
+uint64_t hashPolyhedron(const Polyhedron& poly, const Vertex& origin, double density);
+
+struct CacheHeader;
+
+// Persistent open-addressing table of AnalysisRecords in a memory-mapped
+// file. Lookups touch only the mapped slots, so a hit costs a hash probe.
+// Safe for concurrent use by threads of one process and by several processes
+// sharing the file: writers take an flock on `path.lock` (the table itself is
+// replaced by rename when it grows) and remap if another process replaced it.
+class ResultCache {
+public:
+    ResultCache();
+    ~ResultCache();
+
+    bool open(const string& path); // Creates the file if missing or incompatible
+    bool isOpen() const { return records_ != nullptr; }
+
+    bool lookup(uint64_t key, AnalysisRecord& record);
+    // Merges the flagged fields of `record` into the stored entry for its key
+    void store(const AnalysisRecord& record);
+
+private:
+    bool attach();
+    bool map(size_t capacity, bool create);
+    void unmap();
+    bool replaced() const;
+    AnalysisRecord* findSlot(uint64_t key);
+    bool grow();
+
+    string path_;
+    int fd_;
+    int lockFd_;
+    void* mapping_;
+    size_t mappingSize_;
+    CacheHeader* header_;
+    AnalysisRecord* records_;
+    mutex mutex_;
+};
+
+struct TaskState;
+
+// Fills in the requested CacheFlags fields of the record for `poly`, taking
+// whatever `cache` (may be null) already holds and computing and storing the
+// rest. With a task state, reports progress and honours cancellation.
+AnalysisRecord analysePolyhedron(const Polyhedron& poly, const Vertex& origin, double density,
+                                 ResultCache* cache, uint32_t wanted, TaskState* state = nullptr);
+
+#endif
@@ -0,0 +1,584 @@
+#include "collision.h"
+#include "facemesh.h"
+#include "hull.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace std;
+using namespace Eigen;
+
+static Vector3d toVector(const Vertex& v) {
+    return Vector3d(v.x, v.y, v.z);
+}
+
+struct Triangle {
+    Vector3d p[3];
+};
+
+struct BvhNode {
+    Vector3d lo, hi;
+    int left, right;   // Children, or -1 in a leaf
+    int first, count;  // Leaf triangles [first, first + count)
+};
+
+// Narrow-phase data for one scene mesh, in the mesh's own frame
+struct MeshShape {
+    bool convex;
+    vector<Vector3d> points;     // Outer shell vertices, for support and projection queries
+    vector<Triangle> triangles;  // Every shell, fan-triangulated
+    vector<BvhNode> nodes;       // nodes[0] is the root
+};
+
+static void appendTriangles(const Polyhedron& shell, vector<Triangle>& triangles) {
+    for (const Face& face : shell.faces) {
+        for (size_t i = 1; i + 1 < face.edges.size(); ++i) {
+            Triangle tri;
+            tri.p[0] = toVector(face.edges[0].v1);
+            tri.p[1] = toVector(face.edges[i].v1);
+            tri.p[2] = toVector(face.edges[i + 1].v1);
+            triangles.push_back(tri);
+        }
+    }
+    for (const Polyhedron& hole : shell.sub_polyhedrons) {
+        appendTriangles(hole, triangles);
+    }
+}
+
+// Median split on the longest axis of the triangle centroids, four triangles per leaf
+static int buildBvhNode(vector<Triangle>& triangles, vector<BvhNode>& nodes, int first, int count) {
+    BvhNode node;
+    node.lo = Vector3d::Constant(numeric_limits<double>::max());
+    node.hi = -node.lo;
+    Vector3d centreLo = node.lo, centreHi = node.hi;
+    for (int i = first; i < first + count; ++i) {
+        const Triangle& tri = triangles[i];
+        for (int k = 0; k < 3; ++k) {
+            node.lo = node.lo.cwiseMin(tri.p[k]);
+            node.hi = node.hi.cwiseMax(tri.p[k]);
+        }
+        Vector3d centre = tri.p[0] + tri.p[1] + tri.p[2];
+        centreLo = centreLo.cwiseMin(centre);
+        centreHi = centreHi.cwiseMax(centre);
+    }
+    node.left = node.right = -1;
+    node.first = first;
+    node.count = count;
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(node);
+    if (count <= 4) return index;
+
+    int axis;
+    (centreHi - centreLo).maxCoeff(&axis);
+    int mid = first + count / 2;
+    nth_element(triangles.begin() + first, triangles.begin() + mid, triangles.begin() + first + count,
+                [axis](const Triangle& a, const Triangle& b) {
+                    return a.p[0](axis) + a.p[1](axis) + a.p[2](axis) < b.p[0](axis) + b.p[1](axis) + b.p[2](axis);
+                });
+    int left = buildBvhNode(triangles, nodes, first, mid - first);
+    int right = buildBvhNode(triangles, nodes, mid, first + count - mid);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+static unique_ptr<MeshShape> buildMeshShape(const SceneMesh& mesh) {
+    unique_ptr<MeshShape> shape(new MeshShape());
+    const Polyhedron& poly = *mesh.poly;
+    shape->convex = isConvexSolid(classifyShells(poly));
+    for (const Vertex& v : poly.vertices) shape->points.push_back(toVector(v));
+    appendTriangles(poly, shape->triangles);
+    if (!shape->triangles.empty()) {
+        buildBvhNode(shape->triangles, shape->nodes, 0, static_cast<int>(shape->triangles.size()));
+    }
+    return shape;
+}
+
+// Furthest transformed point of the shape along d
+static Vector3d support(const MeshShape& shape, const AffineMap& map, const Vector3d& d) {
+    Vector3d local = map.linear.transpose() * d;
+    size_t best = 0;
+    double bestDot = -numeric_limits<double>::max();
+    for (size_t i = 0; i < shape.points.size(); ++i) {
+        double dot = shape.points[i].dot(local);
+        if (dot > bestDot) {
+            bestDot = dot;
+            best = i;
+        }
+    }
+    return map.linear * shape.points[best] + map.translation;
+}
+
+// GJK simplex update. The newest point is last; returns true once the
+// simplex encloses the origin, otherwise trims it and sets the next direction.
+static bool updateSimplex(vector<Vector3d>& simplex, Vector3d& d) {
+    const Vector3d a = simplex.back();
+    const Vector3d ao = -a;
+
+    if (simplex.size() == 2) {
+        Vector3d ab = simplex[0] - a;
+        if (ab.dot(ao) > 0) {
+            d = ab.cross(ao).cross(ab);
+        } else {
+            simplex.assign(1, a);
+            d = ao;
+        }
+        return d.squaredNorm() == 0;  // Origin on the segment
+    }
+
+    if (simplex.size() == 3) {
+        Vector3d b = simplex[1], c = simplex[0];
+        Vector3d ab = b - a, ac = c - a, abc = ab.cross(ac);
+        if (abc.cross(ac).dot(ao) > 0) {
+            if (ac.dot(ao) > 0) {
+                simplex = {c, a};
+                d = ac.cross(ao).cross(ac);
+                return d.squaredNorm() == 0;
+            }
+            simplex = {b, a};
+            return updateSimplex(simplex, d);
+        }
+        if (ab.cross(abc).dot(ao) > 0) {
+            simplex = {b, a};
+            return updateSimplex(simplex, d);
+        }
+        double side = abc.dot(ao);
+        if (side == 0) return true;  // Origin in the triangle
+        if (side > 0) {
+            d = abc;
+        } else {
+            simplex = {b, c, a};
+            d = -abc;
+        }
+        return false;
+    }
+
+    // Tetrahedron: look for a face the origin lies beyond, with normals pointing away from the fourth point
+    const Vector3d others[3] = {simplex[0], simplex[1], simplex[2]};
+    for (int skip = 0; skip < 3; ++skip) {
+        const Vector3d& p = others[(skip + 1) % 3];
+        const Vector3d& q = others[(skip + 2) % 3];
+        Vector3d n = (p - a).cross(q - a);
+        if (n.dot(others[skip] - a) > 0) n = -n;
+        if (n.dot(ao) > 0) {
+            simplex = {q, p, a};
+            return updateSimplex(simplex, d);
+        }
+    }
+    return true;
+}
+
+// 1 if the convex hulls overlap, 0 if they are separate (or only touch), -1 if GJK did not converge
+static int gjkIntersect(const MeshShape& A, const AffineMap& mapA, const MeshShape& B, const AffineMap& mapB) {
+    Vector3d d = mapA.translation - mapB.translation;
+    if (d.squaredNorm() == 0) d = Vector3d::UnitX();
+
+    vector<Vector3d> simplex;
+    simplex.reserve(4);
+    simplex.push_back(support(A, mapA, d) - support(B, mapB, -d));
+    d = -simplex[0];
+    for (int iteration = 0; iteration < 64; ++iteration) {
+        if (d.squaredNorm() == 0) return 1;
+        Vector3d point = support(A, mapA, d) - support(B, mapB, -d);
+        if (point.dot(d) <= 0) return 0;
+        simplex.push_back(point);
+        if (updateSimplex(simplex, d)) return 1;
+    }
+    return -1;
+}
+
+// Proper crossing of segment pq through the triangle (Moller-Trumbore);
+// segments lying in the triangle's plane and endpoints on it do not count
+static bool segmentCrossesTriangle(const Vector3d& p, const Vector3d& q, const Triangle& tri) {
+    double t;
+    return rayHitsTriangle(p, q - p, tri.p[0], tri.p[1], tri.p[2], t, 1e-12) && t > 0 && t < 1;
+}
+
+// Two non-coplanar triangles intersect iff an edge of one crosses the other
+static bool trianglesIntersect(const Triangle& a, const Triangle& b) {
+    for (int k = 0; k < 3; ++k) {
+        if (segmentCrossesTriangle(a.p[k], a.p[(k + 1) % 3], b)) return true;
+        if (segmentCrossesTriangle(b.p[k], b.p[(k + 1) % 3], a)) return true;
+    }
+    return false;
+}
+
+// Simultaneous descent of both BVHs, with B's boxes carried into A's frame
+static bool surfacesIntersect(const MeshShape& A, const MeshShape& B, const AffineMap& bToA) {
+    if (A.nodes.empty() || B.nodes.empty()) return false;
+    Matrix3d absLinear = bToA.linear.cwiseAbs();
+
+    vector<pair<int, int> > stack(1, make_pair(0, 0));
+    while (!stack.empty()) {
+        pair<int, int> top = stack.back();
+        stack.pop_back();
+        const BvhNode& na = A.nodes[top.first];
+        const BvhNode& nb = B.nodes[top.second];
+        Vector3d centre = bToA.linear * ((nb.lo + nb.hi) / 2) + bToA.translation;
+        Vector3d half = absLinear * ((nb.hi - nb.lo) / 2);
+        if ((centre - half - na.hi).maxCoeff() > 0 || (na.lo - centre - half).maxCoeff() > 0) continue;
+
+        bool leafA = na.left < 0, leafB = nb.left < 0;
+        if (leafA && leafB) {
+            for (int j = nb.first; j < nb.first + nb.count; ++j) {
+                Triangle mapped;
+                for (int k = 0; k < 3; ++k) mapped.p[k] = bToA.linear * B.triangles[j].p[k] + bToA.translation;
+                for (int i = na.first; i < na.first + na.count; ++i) {
+                    if (trianglesIntersect(A.triangles[i], mapped)) return true;
+                }
+            }
+        } else if (leafB || (!leafA && (na.hi - na.lo).squaredNorm() >= 4 * half.squaredNorm())) {
+            stack.push_back(make_pair(na.left, top.second));
+            stack.push_back(make_pair(na.right, top.second));
+        } else {
+            stack.push_back(make_pair(top.first, nb.left));
+            stack.push_back(make_pair(top.first, nb.right));
+        }
+    }
+    return false;
+}
+
+// Ray parity over every shell of the shape, in its own frame
+static bool containsPoint(const MeshShape& shape, const Vector3d& point) {
+    if (shape.nodes.empty()) return false;
+    const Vector3d dir = parityRayDirection();
+    const Vector3d inv = dir.cwiseInverse();
+
+    int crossings = 0;
+    vector<int> stack(1, 0);
+    while (!stack.empty()) {
+        const BvhNode& node = shape.nodes[stack.back()];
+        stack.pop_back();
+        Vector3d t1 = (node.lo - point).cwiseProduct(inv);
+        Vector3d t2 = (node.hi - point).cwiseProduct(inv);
+        double enter = t1.cwiseMin(t2).maxCoeff(), exit = t1.cwiseMax(t2).minCoeff();
+        if (exit < max(enter, 0.0)) continue;
+
+        if (node.left >= 0) {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            const Triangle& tri = shape.triangles[i];
+            double t;
+            if (rayHitsTriangle(point, dir, tri.p[0], tri.p[1], tri.p[2], t) && t > 0) crossings++;
+        }
+    }
+    return crossings % 2 == 1;
+}
+
+static Vector3d triangleCentre(const Triangle& tri) {
+    return (tri.p[0] + tri.p[1] + tri.p[2]) / 3.0;
+}
+
+static bool solidsOverlap(const MeshShape& A, const AffineMap& mapA, const MeshShape& B, const AffineMap& mapB, bool& usedGjk) {
+    usedGjk = false;
+    if (A.convex && B.convex) {
+        int result = gjkIntersect(A, mapA, B, mapB);
+        if (result >= 0) {
+            usedGjk = true;
+            return result == 1;
+        }
+    }
+
+    AffineMap bToA = inverseMap(mapA) * mapB;
+    if (surfacesIntersect(A, B, bToA)) return true;
+    // No surface crossings: the only way left to overlap is one solid wholly inside the other
+    if (!B.triangles.empty()) {
+        Vector3d probe = triangleCentre(B.triangles[0]);
+        if (containsPoint(A, bToA.linear * probe + bToA.translation)) return true;
+    }
+    if (!A.triangles.empty()) {
+        AffineMap aToB = inverseMap(mapB) * mapA;
+        Vector3d probe = triangleCentre(A.triangles[0]);
+        if (containsPoint(B, aToB.linear * probe + aToB.translation)) return true;
+    }
+    return false;
+}
+
+// Extents of the mapped shape along the unit axes whose `skip` bit is clear, in one pass over its points
+static void projectShape(const MeshShape& shape, const AffineMap& map, const Vector3d* axes, int count, unsigned skip,
+                         double* lo, double* hi) {
+    Vector3d local[7];
+    int slot[7];
+    int used = 0;
+    for (int k = 0; k < count; ++k) {
+        if (skip >> k & 1) continue;
+        local[used] = map.linear.transpose() * axes[k];
+        slot[used++] = k;
+        lo[k] = numeric_limits<double>::max();
+        hi[k] = -numeric_limits<double>::max();
+    }
+    if (used == 0) return;
+    for (const Vector3d& p : shape.points) {
+        for (int j = 0; j < used; ++j) {
+            double t = p.dot(local[j]);
+            lo[slot[j]] = min(lo[slot[j]], t);
+            hi[slot[j]] = max(hi[slot[j]], t);
+        }
+    }
+    for (int j = 0; j < used; ++j) {
+        double offset = map.translation.dot(axes[slot[j]]);
+        lo[slot[j]] += offset;
+        hi[slot[j]] += offset;
+    }
+}
+
+// Positive s with L^T L = s^2 I (rotation, reflection and uniform scale), or 0
+static double conformalScale(const Matrix3d& L) {
+    Matrix3d gram = L.transpose() * L;
+    double s2 = gram.trace() / 3.0;
+    if (s2 <= 0 || (gram - s2 * Matrix3d::Identity()).cwiseAbs().maxCoeff() > 1e-9 * s2) return 0;
+    return sqrt(s2);
+}
+
+// Under a conformal map the mesh box is fitted to the very points being
+// projected, so a shape's extents along its own mapped axes are read off the box
+static unsigned ownAxisExtents(const SceneMesh& mesh, const AffineMap& map, const Vector3d* axes, const int* axisOf,
+                               int count, double* lo, double* hi) {
+    double s = conformalScale(map.linear);
+    if (s == 0) return 0;
+    unsigned done = 0;
+    for (int k = 0; k < count; ++k) {
+        if (axisOf[k] < 0) continue;
+        double mid = s * toVector(mesh.box.center).dot(toVector(mesh.box.axes[axisOf[k]])) + map.translation.dot(axes[k]);
+        double half = s * mesh.box.halfExtents[axisOf[k]];
+        lo[k] = mid - half;
+        hi[k] = mid + half;
+        done |= 1u << k;
+    }
+    return done;
+}
+
+static double penetrationEstimate(const SceneMesh& meshA, const MeshShape& A, const AffineMap& mapA,
+                                  const SceneMesh& meshB, const MeshShape& B, const AffineMap& mapB) {
+    Vector3d axes[7];
+    int axisOfA[7], axisOfB[7];
+    int count = 0;
+    auto addAxis = [&](const Vector3d& axis, int ofA, int ofB) {
+        double length = axis.norm();
+        if (length == 0) return;
+        axes[count] = axis / length;
+        axisOfA[count] = ofA;
+        axisOfB[count] = ofB;
+        ++count;
+    };
+    for (int k = 0; k < 3; ++k) {
+        addAxis(mapA.linear * toVector(meshA.box.axes[k]), k, -1);
+        addAxis(mapB.linear * toVector(meshB.box.axes[k]), -1, k);
+    }
+    addAxis(mapB.linear * toVector(meshB.box.center) + mapB.translation -
+            (mapA.linear * toVector(meshA.box.center) + mapA.translation), -1, -1);
+    if (count == 0) return 0;
+
+    double loA[7], hiA[7], loB[7], hiB[7];
+    projectShape(A, mapA, axes, count, ownAxisExtents(meshA, mapA, axes, axisOfA, count, loA, hiA), loA, hiA);
+    projectShape(B, mapB, axes, count, ownAxisExtents(meshB, mapB, axes, axisOfB, count, loB, hiB), loB, hiB);
+    double best = numeric_limits<double>::max();
+    for (int k = 0; k < count; ++k) best = min(best, max(0.0, min(hiA[k], hiB[k]) - max(loA[k], loB[k])));
+    return best;
+}
+
+// An instance's mesh box in world space: a parallelepiped given by its centre
+// and three half-edge vectors (a box unless the instance is sheared)
+struct WorldBox {
+    Vector3d centre;
+    Vector3d edges[3];
+};
+
+static WorldBox worldBox(const Scene& scene, const SceneInstance& instance) {
+    const OrientedBox& box = scene.mesh(instance.mesh).box;
+    const AffineMap& map = instance.transform;
+    WorldBox result;
+    result.centre = map.linear * toVector(box.center) + map.translation;
+    for (int k = 0; k < 3; ++k) result.edges[k] = map.linear * toVector(box.axes[k]) * box.halfExtents[k];
+    return result;
+}
+
+// Separating-axis test over the face normals of both and the cross products of their edges
+static bool boxesSeparated(const WorldBox& a, const WorldBox& b) {
+    Vector3d axes[15];
+    int count = 0;
+    for (int k = 0; k < 3; ++k) {
+        axes[count++] = a.edges[k].cross(a.edges[(k + 1) % 3]);
+        axes[count++] = b.edges[k].cross(b.edges[(k + 1) % 3]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) axes[count++] = a.edges[i].cross(b.edges[j]);
+    }
+
+    Vector3d d = b.centre - a.centre;
+    for (const Vector3d& n : axes) {
+        if (n.squaredNorm() == 0) continue;
+        double ra = fabs(a.edges[0].dot(n)) + fabs(a.edges[1].dot(n)) + fabs(a.edges[2].dot(n));
+        double rb = fabs(b.edges[0].dot(n)) + fabs(b.edges[1].dot(n)) + fabs(b.edges[2].dot(n));
+        if (fabs(d.dot(n)) > ra + rb) return true;
+    }
+    return false;
+}
+
+Aabb instanceBounds(const Scene& scene, const SceneInstance& instance) {
+    const OrientedBox& box = scene.mesh(instance.mesh).box;
+    const Matrix3d& L = instance.transform.linear;
+    Vector3d centre = L * toVector(box.center) + instance.transform.translation;
+    Vector3d half = Vector3d::Zero();
+    for (int k = 0; k < 3; ++k) {
+        half += (L * toVector(box.axes[k])).cwiseAbs() * box.halfExtents[k];
+    }
+    Aabb bounds;
+    for (int r = 0; r < 3; ++r) {
+        bounds.lo[r] = centre(r) - half(r);
+        bounds.hi[r] = centre(r) + half(r);
+    }
+    return bounds;
+}
+
+OverlapReport findOverlaps(const Scene& scene, unsigned numThreads) {
+    const vector<SceneInstance>& instances = scene.instances();
+    OverlapReport report;
+    report.instances = instances.size();
+    report.convexTests = report.generalTests = 0;
+
+    // Broad phase: sort by the low x bound and sweep, keeping the boxes the sweep line is inside
+    vector<Aabb> bounds(instances.size());
+    vector<int> order(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i) {
+        bounds[i] = instanceBounds(scene, instances[i]);
+        order[i] = static_cast<int>(i);
+    }
+    sort(order.begin(), order.end(), [&bounds](int a, int b) { return bounds[a].lo[0] < bounds[b].lo[0]; });
+
+    // A single active list grows with the whole cross-section of the scene, so
+    // it is split into slabs along y about two typical boxes tall; a box joins
+    // every slab it reaches and is only compared within those. A pair sharing
+    // several slabs is reported from the lowest of them only.
+    double yLo = numeric_limits<double>::max(), yHi = -numeric_limits<double>::max();
+    vector<double> heights(bounds.size());
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        yLo = min(yLo, bounds[i].lo[1]);
+        yHi = max(yHi, bounds[i].hi[1]);
+        heights[i] = bounds[i].hi[1] - bounds[i].lo[1];
+    }
+    int numSlabs = 1;
+    double slabHeight = 1;
+    if (!heights.empty()) {
+        nth_element(heights.begin(), heights.begin() + heights.size() / 2, heights.end());
+        slabHeight = max(2 * heights[heights.size() / 2], (yHi - yLo) / 1024);
+        if (slabHeight > 0) numSlabs = max(1, static_cast<int>(ceil((yHi - yLo) / slabHeight)));
+    }
+    auto slabOf = [&](double y) {
+        int slab = numSlabs == 1 ? 0 : static_cast<int>((y - yLo) / slabHeight);
+        return min(max(slab, 0), numSlabs - 1);
+    };
+
+    // Active boxes are copied into contiguous arrays so the inner loop streams through memory
+    struct ActiveBox {
+        double hi0, lo1, hi1, lo2, hi2;
+        int id, firstSlab;
+    };
+    vector<pair<int, int> > candidates;
+    vector<vector<ActiveBox> > slabs(numSlabs);
+    for (int i : order) {
+        const Aabb& box = bounds[i];
+        int first = slabOf(box.lo[1]), last = slabOf(box.hi[1]);
+        ActiveBox entry = {box.hi[0], box.lo[1], box.hi[1], box.lo[2], box.hi[2], i, first};
+        for (int s = first; s <= last; ++s) {
+            vector<ActiveBox>& active = slabs[s];
+            size_t kept = 0;
+            for (size_t k = 0; k < active.size(); ++k) {
+                const ActiveBox& other = active[k];
+                if (other.hi0 < box.lo[0]) continue;  // The sweep has passed it for good
+                active[kept++] = other;
+                if (other.lo1 <= box.hi[1] && box.lo[1] <= other.hi1 && other.lo2 <= box.hi[2] && box.lo[2] <= other.hi2 &&
+                    max(first, other.firstSlab) == s) {
+                    candidates.push_back(make_pair(min(i, other.id), max(i, other.id)));
+                }
+            }
+            active.resize(kept);
+            active.push_back(entry);
+        }
+    }
+    report.candidatePairs = candidates.size();
+
+    // Narrow-phase shapes and world boxes, built once per mesh (or instance) that takes part in a candidate pair
+    vector<WorldBox> boxes(instances.size());
+    vector<char> hasBox(instances.size(), 0);
+    vector<unique_ptr<MeshShape> > shapes(scene.numMeshes());
+    for (const auto& candidate : candidates) {
+        for (int instance : {candidate.first, candidate.second}) {
+            int mesh = instances[instance].mesh;
+            if (!shapes[mesh]) shapes[mesh] = buildMeshShape(scene.mesh(mesh));
+            if (!hasBox[instance]) {
+                boxes[instance] = worldBox(scene, instances[instance]);
+                hasBox[instance] = 1;
+            }
+        }
+    }
+    for (const auto& shape : shapes) {
+        if (!shape) continue;
+        accountVector(shape->points, report.shapeMemory.bvhBytes, report.shapeMemory);
+        accountVector(shape->triangles, report.shapeMemory.bvhBytes, report.shapeMemory);
+        accountVector(shape->nodes, report.shapeMemory.bvhBytes, report.shapeMemory);
+    }
+
+    if (numThreads == 0) numThreads = thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 1;
+    numThreads = static_cast<unsigned>(max<size_t>(1, min<size_t>(numThreads, candidates.size())));
+
+    // Pair costs vary widely, so workers claim small blocks from a shared counter
+    const size_t blockSize = 64;
+    atomic<size_t> nextBlock(0);
+    vector<vector<OverlapPair> > found(numThreads);
+    vector<size_t> convexTests(numThreads, 0), generalTests(numThreads, 0);
+    auto work = [&](unsigned worker) {
+        while (true) {
+            size_t begin = nextBlock.fetch_add(blockSize);
+            if (begin >= candidates.size()) break;
+            size_t end = min(candidates.size(), begin + blockSize);
+            for (size_t c = begin; c < end; ++c) {
+                // The tight boxes reject most candidates from the loose axis-aligned ones
+                if (boxesSeparated(boxes[candidates[c].first], boxes[candidates[c].second])) continue;
+                const SceneInstance& a = instances[candidates[c].first];
+                const SceneInstance& b = instances[candidates[c].second];
+                const MeshShape& shapeA = *shapes[a.mesh];
+                const MeshShape& shapeB = *shapes[b.mesh];
+                bool usedGjk;
+                bool overlap = solidsOverlap(shapeA, a.transform, shapeB, b.transform, usedGjk);
+                (usedGjk ? convexTests : generalTests)[worker]++;
+                if (!overlap) continue;
+
+                OverlapPair pair;
+                pair.a = candidates[c].first;
+                pair.b = candidates[c].second;
+                pair.penetration = penetrationEstimate(scene.mesh(a.mesh), shapeA, a.transform, scene.mesh(b.mesh), shapeB, b.transform);
+
+                // The estimate bounds the width of the shared region from above, so a
+                // (rounding-level) zero means the surfaces only touch
+                const Aabb& boxA = bounds[pair.a];
+                const Aabb& boxB = bounds[pair.b];
+                double size = 0;
+                for (int r = 0; r < 3; ++r) size = max(size, max(boxA.hi[r] - boxA.lo[r], boxB.hi[r] - boxB.lo[r]));
+                if (pair.penetration <= 1e-9 * size) continue;
+                found[worker].push_back(pair);
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned w = 1; w < numThreads; ++w) workers.push_back(thread(work, w));
+    work(0);
+    for (auto& worker : workers) worker.join();
+
+    for (unsigned w = 0; w < numThreads; ++w) {
+        report.pairs.insert(report.pairs.end(), found[w].begin(), found[w].end());
+        report.convexTests += convexTests[w];
+        report.generalTests += generalTests[w];
+    }
+    sort(report.pairs.begin(), report.pairs.end(), [](const OverlapPair& x, const OverlapPair& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    return report;
+}
@@ -0,0 +1,41 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "scene.h"
+#include "memory.h"
+
+struct Aabb {
+    double lo[3], hi[3];
+};
+
+struct OverlapPair {
+    int a, b;            // Instance indices, a < b
+    double penetration;  // Estimated depth, see findOverlaps
+};
+
+struct OverlapReport {
+    size_t instances;
+    size_t candidatePairs;   // Pairs whose axis-aligned boxes overlap (broad phase)
+    size_t convexTests;      // Narrow-phase pairs settled by GJK
+    size_t generalTests;     // Narrow-phase pairs settled by the triangle BVHs
+    vector<OverlapPair> pairs;  // Sorted by (a, b)
+    MemoryFootprint shapeMemory; // Narrow-phase shapes and BVHs built for this search
+};
+
+// World-space box around an instance's outer shell, from its transformed mesh box
+Aabb instanceBounds(const Scene& scene, const SceneInstance& instance);
+
+// Every pair of scene instances whose solids overlap. The broad phase sweeps
+// and prunes the instance boxes along x (with the active set binned by y).
+// The narrow phase runs on worker threads: a separating-axis test on the
+// instances' oriented boxes, then GJK when both meshes are convex, otherwise
+// triangle-triangle tests over a BVH per mesh plus a ray-parity test for a
+// solid wholly inside the other. Surfaces that only touch do not count: a
+// pair is dropped when its penetration estimate is zero to rounding.
+// `penetration` is the smallest overlap of the two solids' projections onto
+// their principal axes and the line between their centres: the true depth
+// for convex solids when one of those is the separating direction, an upper
+// bound otherwise.
+OverlapReport findOverlaps(const Scene& scene, unsigned numThreads = 0);
+
+#endif
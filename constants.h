@@ -19,10 +19,21 @@
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
 const double EPSILON = 1e-9;
+const double WELD_TOLERANCE = 1e-9; // Vertices closer than this are merged on input
+const double RECONSTRUCTION_TOLERANCE = 1e-6; // Views may disagree on a vertex by this much before it is flagged
+const double CONVEXITY_TOLERANCE = 1e-6; // Relative volume and area gap below which a shell counts as its own hull
+const size_t DEVIATION_SAMPLES = 1 << 20;  // Area samples per surface when comparing two parts
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 const float ISO_ANGLE = M_PI / 6; // 30 degrees
 const float SCALE_FACTOR = 50.0f;
+const double LOD_PIXEL_TOLERANCE = 0.5;  // On-screen error a simplified level may show while rotating
+const double LOD_FRAME_BUDGET_MS = 12.0; // Drawing time per frame the viewer aims for while rotating
+const int LOD_SETTLE_MS = 250;           // Full detail once the view has been still this long
+const int FRAME_MS = 16;                 // Display interval the viewer paces itself to, about 60 FPS
+const size_t HISTORY_CHUNK_VERTICES = 4096;   // Vertices per shared chunk of a transform history snapshot
+const size_t HISTORY_SNAPSHOT_INTERVAL = 8;   // Steps between snapshots until the history thins them
+const size_t HISTORY_MAX_SNAPSHOTS = 16;      // Even, so thinning keeps the newest
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include "deviation.h"
+#include "scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+// Queries per block handed to a worker; also fixes where each block's random stream starts
+static const size_t DEVIATION_BLOCK = 4096;
+
+struct SurfaceTriangle {
+    Vertex a, b, c;
+};
+
+struct SurfaceNode {
+    double lo[3], hi[3];
+    int left, right;   // Children, or -1 in a leaf
+    int first, count;  // Leaf triangles [first, first + count)
+};
+
+// One surface ready for distance queries and sampling. Triangles are stored
+// in tree order, so neighbouring triangles are close in space and in memory.
+struct SurfaceBvh {
+    vector<SurfaceTriangle> triangles;
+    vector<int> faces;              // Face of each triangle, numbered as in DeviationReport::faceDeviation
+    vector<SurfaceNode> nodes;      // nodes[0] is the root
+    vector<double> cumulativeArea;  // Area of triangles [0, i], for sampling
+    vector<Vertex> vertices;        // Every shell's vertices
+    vector<Vertex> centroids;       // Vertex average of each face
+};
+
+static Vertex lerp3(const Vertex& a, const Vertex& b, const Vertex& c, double wa, double wb, double wc) {
+    return {wa * a.x + wb * b.x + wc * c.x, wa * a.y + wb * b.y + wc * c.y, wa * a.z + wb * b.z + wc * c.z};
+}
+
+static double dot3(const Vertex& a, const Vertex& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Vertex minus3(const Vertex& a, const Vertex& b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+// Fan triangles of every face on their face's own vertices (Edge::i1 loops)
+static void appendShell(const Polyhedron& shell, SurfaceBvh& surface, int& face) {
+    for (const Face& f : shell.faces) {
+        size_t n = f.edges.size();
+        Vertex centroid = {0, 0, 0};
+        for (const Edge& edge : f.edges) {
+            const Vertex& v = shell.vertices[edge.i1];
+            centroid.x += v.x;
+            centroid.y += v.y;
+            centroid.z += v.z;
+        }
+        if (n > 0) centroid = {centroid.x / n, centroid.y / n, centroid.z / n};
+        surface.centroids.push_back(centroid);
+
+        for (size_t i = 1; i + 1 < n; ++i) {
+            SurfaceTriangle tri = {shell.vertices[f.edges[0].i1], shell.vertices[f.edges[i].i1],
+                                   shell.vertices[f.edges[i + 1].i1]};
+            surface.triangles.push_back(tri);
+            surface.faces.push_back(face);
+        }
+        ++face;
+    }
+    surface.vertices.insert(surface.vertices.end(), shell.vertices.begin(), shell.vertices.end());
+    for (const Polyhedron& hole : shell.sub_polyhedrons) {
+        appendShell(hole, surface, face);
+    }
+}
+
+// Median split on the longest axis of the triangle centres, four triangles
+// per leaf, as for the collision BVHs; `order` is permuted in place
+static int buildNode(const vector<SurfaceTriangle>& triangles, const vector<Vertex>& centres, vector<int>& order,
+                     vector<SurfaceNode>& nodes, int first, int count) {
+    SurfaceNode node;
+    double centreLo[3], centreHi[3];
+    for (int k = 0; k < 3; ++k) {
+        node.lo[k] = centreLo[k] = numeric_limits<double>::max();
+        node.hi[k] = centreHi[k] = -numeric_limits<double>::max();
+    }
+    for (int i = first; i < first + count; ++i) {
+        const SurfaceTriangle& tri = triangles[order[i]];
+        for (const Vertex* v : {&tri.a, &tri.b, &tri.c}) {
+            const double c[3] = {v->x, v->y, v->z};
+            for (int k = 0; k < 3; ++k) {
+                node.lo[k] = min(node.lo[k], c[k]);
+                node.hi[k] = max(node.hi[k], c[k]);
+            }
+        }
+        const Vertex& centre = centres[order[i]];
+        const double c[3] = {centre.x, centre.y, centre.z};
+        for (int k = 0; k < 3; ++k) {
+            centreLo[k] = min(centreLo[k], c[k]);
+            centreHi[k] = max(centreHi[k], c[k]);
+        }
+    }
+    node.left = node.right = -1;
+    node.first = first;
+    node.count = count;
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(node);
+    if (count <= 4) return index;
+
+    int axis = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (centreHi[k] - centreLo[k] > centreHi[axis] - centreLo[axis]) axis = k;
+    }
+    int mid = first + count / 2;
+    nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count, [&centres, axis](int a, int b) {
+        const Vertex& p = centres[a];
+        const Vertex& q = centres[b];
+        return (axis == 0 ? p.x : axis == 1 ? p.y : p.z) < (axis == 0 ? q.x : axis == 1 ? q.y : q.z);
+    });
+    int left = buildNode(triangles, centres, order, nodes, first, mid - first);
+    int right = buildNode(triangles, centres, order, nodes, mid, first + count - mid);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+static shared_ptr<const SurfaceBvh> buildSurface(const Polyhedron& poly) {
+    SurfaceBvh fan;
+    int face = 0;
+    appendShell(poly, fan, face);
+
+    shared_ptr<SurfaceBvh> surface = make_shared<SurfaceBvh>();
+    surface->vertices.swap(fan.vertices);
+    surface->centroids.swap(fan.centroids);
+    if (fan.triangles.empty()) return surface;
+
+    vector<Vertex> centres(fan.triangles.size());
+    vector<int> order(fan.triangles.size());
+    for (size_t i = 0; i < fan.triangles.size(); ++i) {
+        const SurfaceTriangle& tri = fan.triangles[i];
+        centres[i] = lerp3(tri.a, tri.b, tri.c, 1.0 / 3, 1.0 / 3, 1.0 / 3);
+        order[i] = static_cast<int>(i);
+    }
+    surface->nodes.reserve(fan.triangles.size() / 2);
+    buildNode(fan.triangles, centres, order, surface->nodes, 0, static_cast<int>(order.size()));
+
+    surface->triangles.reserve(order.size());
+    surface->faces.reserve(order.size());
+    surface->cumulativeArea.reserve(order.size());
+    double total = 0;
+    for (int i : order) {
+        const SurfaceTriangle& tri = fan.triangles[i];
+        Vertex ab = minus3(tri.b, tri.a), ac = minus3(tri.c, tri.a);
+        Vertex n = {ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x};
+        total += sqrt(dot3(n, n)) / 2;
+        surface->triangles.push_back(tri);
+        surface->faces.push_back(fan.faces[i]);
+        surface->cumulativeArea.push_back(total);
+    }
+    return surface;
+}
+
+// Closest point on the triangle by Voronoi region (Ericson, Real-Time Collision Detection 5.1.5)
+static double pointTriangleSquared(const Vertex& p, const SurfaceTriangle& tri) {
+    const Vertex& a = tri.a;
+    const Vertex& b = tri.b;
+    const Vertex& c = tri.c;
+    Vertex ab = minus3(b, a), ac = minus3(c, a), ap = minus3(p, a);
+    Vertex closest;
+    double d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+    if (d1 <= 0 && d2 <= 0) {
+        closest = a;
+    } else {
+        Vertex bp = minus3(p, b);
+        double d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+        Vertex cp = minus3(p, c);
+        double d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+        double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+        if (d3 >= 0 && d4 <= d3) {
+            closest = b;
+        } else if (d6 >= 0 && d5 <= d6) {
+            closest = c;
+        } else if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+            double t = d1 / (d1 - d3);
+            closest = lerp3(a, b, c, 1 - t, t, 0);
+        } else if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+            double t = d2 / (d2 - d6);
+            closest = lerp3(a, b, c, 1 - t, 0, t);
+        } else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+            double t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            closest = lerp3(a, b, c, 0, 1 - t, t);
+        } else {
+            double sum = va + vb + vc;
+            if (sum > 0) {
+                closest = lerp3(a, b, c, 1 - (vb + vc) / sum, vb / sum, vc / sum);
+            } else {
+                closest = a;  // Degenerate triangle
+            }
+        }
+    }
+    Vertex d = minus3(p, closest);
+    return dot3(d, d);
+}
+
+static double boxSquared(const SurfaceNode& node, const Vertex& p) {
+    const double c[3] = {p.x, p.y, p.z};
+    double sum = 0;
+    for (int k = 0; k < 3; ++k) {
+        double gap = max(max(node.lo[k] - c[k], c[k] - node.hi[k]), 0.0);
+        sum += gap * gap;
+    }
+    return sum;
+}
+
+// Distance from p to the surface. `hint` is a triangle to take the first
+// bound from and comes back as the nearest one; `stack` is reused scratch.
+static double nearestDistance(const SurfaceBvh& surface, const Vertex& p, int& hint, vector<int>& stack) {
+    double best = hint >= 0 ? pointTriangleSquared(p, surface.triangles[hint]) : numeric_limits<double>::max();
+    stack.assign(1, 0);
+    while (!stack.empty()) {
+        const SurfaceNode& node = surface.nodes[stack.back()];
+        stack.pop_back();
+        if (boxSquared(node, p) >= best) continue;
+        if (node.left < 0) {
+            for (int t = node.first; t < node.first + node.count; ++t) {
+                double d = pointTriangleSquared(p, surface.triangles[t]);
+                if (d < best) {
+                    best = d;
+                    hint = t;
+                }
+            }
+            continue;
+        }
+        // Nearer child on top of the stack
+        double left = boxSquared(surface.nodes[node.left], p), right = boxSquared(surface.nodes[node.right], p);
+        int nearChild = left <= right ? node.left : node.right;
+        int farChild = left <= right ? node.right : node.left;
+        if (max(left, right) < best) stack.push_back(farChild);
+        if (min(left, right) < best) stack.push_back(nearChild);
+    }
+    return sqrt(best);
+}
+
+// Sample k of n, from the stratum [k / n, (k + 1) / n) of the surface's area
+static Vertex samplePoint(const SurfaceBvh& surface, size_t k, size_t n, mt19937& rng, int& triangle) {
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    double target = (k + unit(rng)) / n * surface.cumulativeArea.back();
+    size_t t = upper_bound(surface.cumulativeArea.begin(), surface.cumulativeArea.end(), target) - surface.cumulativeArea.begin();
+    triangle = static_cast<int>(min(t, surface.triangles.size() - 1));
+    const SurfaceTriangle& tri = surface.triangles[triangle];
+    double r1 = sqrt(unit(rng)), r2 = unit(rng);
+    return lerp3(tri.a, tri.b, tri.c, 1 - r1, r1 * (1 - r2), r1 * r2);
+}
+
+// Runs fn(begin, end, worker) over [0, count) in blocks claimed from a shared
+// counter. Stops early on cancellation; the caller checks for it afterwards.
+template <typename Fn>
+static void runBlocks(size_t count, unsigned numThreads, TaskState* state, atomic<size_t>& done, size_t total, Fn fn) {
+    atomic<size_t> next(0);
+    auto work = [&](unsigned worker) {
+        while (!(state && state->cancelRequested)) {
+            size_t begin = next.fetch_add(DEVIATION_BLOCK);
+            if (begin >= count) break;
+            size_t end = min(count, begin + DEVIATION_BLOCK);
+            fn(begin, end, worker);
+            size_t finished = done += end - begin;
+            if (state && worker == 0) state->setProgress(static_cast<double>(finished) / total);
+        }
+    };
+    vector<thread> workers;
+    for (unsigned w = 1; w < numThreads; ++w) workers.push_back(thread(work, w));
+    work(0);
+    for (auto& worker : workers) worker.join();
+}
+
+shared_ptr<const SurfaceBvh> DeviationEngine::surface(shared_ptr<const Polyhedron> poly, double& buildSeconds) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        cache_.erase(remove_if(cache_.begin(), cache_.end(),
+                               [](const pair<weak_ptr<const Polyhedron>, shared_ptr<const SurfaceBvh> >& entry) {
+                                   return entry.first.expired();
+                               }),
+                     cache_.end());
+        for (const auto& entry : cache_) {
+            if (entry.first.lock() == poly) return entry.second;
+        }
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    shared_ptr<const SurfaceBvh> built = buildSurface(*poly);
+    buildSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    lock_guard<mutex> lock(mutex_);
+    cache_.push_back(make_pair(weak_ptr<const Polyhedron>(poly), built));
+    return built;
+}
+
+DeviationReport DeviationEngine::measure(shared_ptr<const Polyhedron> measured, shared_ptr<const Polyhedron> reference,
+                                         size_t samples, TaskState* state, unsigned numThreads) {
+    DeviationReport report = DeviationReport();
+    shared_ptr<const SurfaceBvh> A = surface(measured, report.buildSeconds);
+    shared_ptr<const SurfaceBvh> B = surface(reference, report.buildSeconds);
+    report.faceDeviation.assign(A->centroids.size(), 0.0f);
+    if (A->triangles.empty() || B->triangles.empty() || samples == 0) return report;
+    if (state) state->checkCancelled();
+
+    if (numThreads == 0) numThreads = thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 1;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // Each worker keeps its own sums and maxima; only the measured samples are
+    // kept one by one, for the heat map
+    struct Partial {
+        double sum, sumSquares, forward, backward;
+    };
+    vector<Partial> partials(numThreads, Partial());
+    vector<float> sampleDistance(samples);
+    vector<int> sampleFace(samples);
+    const size_t numVertices = A->vertices.size() + B->vertices.size();
+    atomic<size_t> done(0);
+    size_t total = 2 * samples + numVertices;
+
+    // Area samples of both surfaces, then every vertex of both
+    runBlocks(2 * samples + numVertices, numThreads, state, done, total, [&](size_t begin, size_t end, unsigned worker) {
+        Partial& partial = partials[worker];
+        vector<int> stack;
+        mt19937 rng(static_cast<unsigned>(begin / DEVIATION_BLOCK));
+        int hint = -1;
+        for (size_t q = begin; q < end; ++q) {
+            // A block can straddle two kinds of query, and hints only mean something on one surface
+            if (q == samples || q == 2 * samples || q == 2 * samples + A->vertices.size()) hint = -1;
+            int triangle;
+            if (q < samples) {
+                Vertex p = samplePoint(*A, q, samples, rng, triangle);
+                double d = nearestDistance(*B, p, hint, stack);
+                sampleDistance[q] = static_cast<float>(d);
+                sampleFace[q] = A->faces[triangle];
+                partial.sum += d;
+                partial.sumSquares += d * d;
+                partial.forward = max(partial.forward, d);
+            } else if (q < 2 * samples) {
+                Vertex p = samplePoint(*B, q - samples, samples, rng, triangle);
+                double d = nearestDistance(*A, p, hint, stack);
+                partial.sum += d;
+                partial.sumSquares += d * d;
+                partial.backward = max(partial.backward, d);
+            } else if (q < 2 * samples + A->vertices.size()) {
+                double d = nearestDistance(*B, A->vertices[q - 2 * samples], hint, stack);
+                partial.forward = max(partial.forward, d);
+            } else {
+                double d = nearestDistance(*A, B->vertices[q - 2 * samples - A->vertices.size()], hint, stack);
+                partial.backward = max(partial.backward, d);
+            }
+        }
+    });
+    if (state) state->checkCancelled();
+
+    vector<char> sampled(report.faceDeviation.size(), 0);
+    for (size_t k = 0; k < samples; ++k) {
+        float& value = report.faceDeviation[sampleFace[k]];
+        value = max(value, sampleDistance[k]);
+        sampled[sampleFace[k]] = 1;
+    }
+
+    // Faces too small to draw a sample are measured at their centroid
+    vector<int> unsampled;
+    for (size_t f = 0; f < sampled.size(); ++f) {
+        if (!sampled[f]) unsampled.push_back(static_cast<int>(f));
+    }
+    total += unsampled.size();
+    runBlocks(unsampled.size(), numThreads, state, done, total, [&](size_t begin, size_t end, unsigned worker) {
+        vector<int> stack;
+        int hint = -1;
+        for (size_t i = begin; i < end; ++i) {
+            int f = unsampled[i];
+            double d = nearestDistance(*B, A->centroids[f], hint, stack);
+            report.faceDeviation[f] = static_cast<float>(d);
+            partials[worker].forward = max(partials[worker].forward, d);
+        }
+    });
+    if (state) state->checkCancelled();
+
+    double sum = 0, sumSquares = 0;
+    for (const Partial& partial : partials) {
+        sum += partial.sum;
+        sumSquares += partial.sumSquares;
+        report.measuredToReference = max(report.measuredToReference, partial.forward);
+        report.referenceToMeasured = max(report.referenceToMeasured, partial.backward);
+    }
+    report.measuredSamples = report.referenceSamples = samples;
+    report.hausdorff = max(report.measuredToReference, report.referenceToMeasured);
+    report.mean = sum / (2 * samples);
+    report.rms = sqrt(sumSquares / (2 * samples));
+    report.querySeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return report;
+}
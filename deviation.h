@@ -0,0 +1,57 @@
+#ifndef DEVIATION_H
+#define DEVIATION_H
+
+#include "input.h"
+
+#include <memory>
+#include <mutex>
+
+struct TaskState;
+struct SurfaceBvh;
+
+// How far apart two surfaces are, both ways round
+struct DeviationReport {
+    size_t measuredSamples;      // Area samples on each surface
+    size_t referenceSamples;
+    double hausdorff;            // Largest of the two directed distances below
+    double measuredToReference;  // Furthest any probe of the measured surface is from the reference
+    double referenceToMeasured;
+    double mean;                 // Over the area samples of both surfaces
+    double rms;
+    // Per face of the measured part, outer shell first and then holes
+    // depth-first, as in Polyhedron::faces: the largest distance seen on it
+    vector<float> faceDeviation;
+    double buildSeconds;         // Building the surfaces not already cached
+    double querySeconds;
+};
+
+// Samples both surfaces and measures each sample's distance to the other
+// surface.
+//
+// Samples are area-weighted and stratified. The unit interval is cut into
+// one stratum per sample and one point is drawn in each. The point is mapped
+// through the running area of the fan triangles to a point on the surface.
+// Mean and RMS come from these samples alone. The directed maxima also probe
+// every vertex, where piecewise-flat surfaces usually part furthest, and the
+// centroid of every measured face that drew no sample, so every face gets a
+// heat-map value.
+//
+// Nearest distances come from a bounding-volume hierarchy over each surface's
+// triangles. The hierarchy is searched nearest box first and pruned by the
+// best distance so far, and a query starts from the triangle that was nearest
+// to the previous sample. Queries are shared out in blocks to a worker per
+// core. Surfaces are cached per polyhedron for as long as it is alive, so
+// comparing revisions against one reference builds its hierarchy once.
+class DeviationEngine {
+public:
+    DeviationReport measure(shared_ptr<const Polyhedron> measured, shared_ptr<const Polyhedron> reference,
+                            size_t samples = DEVIATION_SAMPLES, TaskState* state = nullptr, unsigned numThreads = 0);
+
+private:
+    shared_ptr<const SurfaceBvh> surface(shared_ptr<const Polyhedron> poly, double& buildSeconds);
+
+    mutex mutex_;
+    vector<pair<weak_ptr<const Polyhedron>, shared_ptr<const SurfaceBvh> > > cache_;
+};
+
+#endif
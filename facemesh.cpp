@@ -0,0 +1,142 @@
+#include "facemesh.h"
+#include "scheduler.h"
+
+using namespace std;
+using namespace Eigen;
+
+FaceMesh buildFaceMesh(const Polyhedron& poly, bool includeHoles) {
+    FaceMesh mesh;
+    mesh.vertices = poly.vertices;
+
+    size_t counts[3] = {0, 0, 0}, polygonIndices = 0;
+    for (const Face& face : poly.faces) {
+        size_t n = face.edges.size();
+        counts[n == 3 ? 0 : n == 4 ? 1 : 2]++;
+        if (n != 3 && n != 4) polygonIndices += n;
+    }
+    mesh.triangles.indices.reserve(3 * counts[0]);
+    mesh.triangles.faceIds.reserve(counts[0]);
+    mesh.quads.indices.reserve(4 * counts[1]);
+    mesh.quads.faceIds.reserve(counts[1]);
+    mesh.polygons.indices.reserve(polygonIndices);
+    mesh.polygons.faceIds.reserve(counts[2]);
+    mesh.polygons.starts.reserve(counts[2] + 1);
+    mesh.polygons.starts.push_back(0);
+
+    for (size_t f = 0; f < poly.faces.size(); ++f) {
+        const vector<Edge>& edges = poly.faces[f].edges;
+        FaceGroup& group = edges.size() == 3 ? mesh.triangles : edges.size() == 4 ? mesh.quads : mesh.polygons;
+        for (const Edge& edge : edges) {
+            group.indices.push_back(edge.i1);
+        }
+        if (&group == &mesh.polygons) {
+            group.starts.push_back(static_cast<int>(group.indices.size()));
+        }
+        group.faceIds.push_back(static_cast<int>(f));
+    }
+
+    if (!includeHoles) return mesh;
+    for (const Polyhedron& hole : poly.sub_polyhedrons) {
+        mesh.holes.push_back(buildFaceMesh(hole));
+    }
+    return mesh;
+}
+
+void KernelProgress::advance(size_t faces) {
+    done += faces;
+    if (!state) return;
+    state->checkCancelled();
+    if (total > 0) state->setProgress(from + (to - from) * min(1.0, static_cast<double>(done) / total));
+}
+
+size_t meshFaceCount(const FaceMesh& mesh) {
+    size_t count = mesh.triangles.size() + mesh.quads.size() + mesh.polygons.size();
+    for (const FaceMesh& hole : mesh.holes) {
+        count += meshFaceCount(hole);
+    }
+    return count;
+}
+
+// Runs fn over every face of the group, in blocks when there is progress to report
+template <int N, typename Fn>
+static void forEachFaceBlock(const FaceGroup& group, KernelProgress* progress, Fn fn) {
+    if (!progress) {
+        forEachFace<N>(group, fn);
+        return;
+    }
+    for (size_t begin = 0; begin < group.size(); begin += KERNEL_BLOCK_FACES) {
+        size_t end = min(group.size(), begin + KERNEL_BLOCK_FACES);
+        forEachFace<N>(group, begin, end, fn);
+        progress->advance(end - begin);
+    }
+}
+
+template <int N>
+static double groupSurfaceArea(const FaceMesh& mesh, const FaceGroup& group, KernelProgress* progress) {
+    const Vertex* vertices = mesh.vertices.data();
+    double total = 0;
+    forEachFaceBlock<N>(group, progress, [&](const int* idx, int n, int) {
+        Vertex area = faceVectorArea<N>(vertices, idx, n);
+        total += std::sqrt(area.x * area.x + area.y * area.y + area.z * area.z) / 2.0;
+    });
+    return total;
+}
+
+float meshSurfaceArea(const FaceMesh& mesh, KernelProgress* progress) {
+    return static_cast<float>(groupSurfaceArea<3>(mesh, mesh.triangles, progress) +
+                              groupSurfaceArea<4>(mesh, mesh.quads, progress) +
+                              groupSurfaceArea<0>(mesh, mesh.polygons, progress));
+}
+
+template <int N>
+static void groupIntegrals(const FaceMesh& mesh, const FaceGroup& group, const Vertex& origin, VolumeIntegrals& sums,
+                           KernelProgress* progress) {
+    const Vertex* vertices = mesh.vertices.data();
+    forEachFaceBlock<N>(group, progress, [&](const int* idx, int n, int) {
+        accumulateFaceIntegrals<N>(vertices, idx, n, origin, sums);
+    });
+}
+
+void accumulateMeshIntegrals(const FaceMesh& mesh, const Vertex& origin, VolumeIntegrals& sums, KernelProgress* progress) {
+    groupIntegrals<3>(mesh, mesh.triangles, origin, sums, progress);
+    groupIntegrals<4>(mesh, mesh.quads, origin, sums, progress);
+    groupIntegrals<0>(mesh, mesh.polygons, origin, sums, progress);
+    // Holes are oriented inwards, so they subtract themselves
+    for (const FaceMesh& hole : mesh.holes) {
+        accumulateMeshIntegrals(hole, origin, sums, progress);
+    }
+}
+
+template <int N>
+static double groupProjectedArea(const FaceMesh& mesh, const FaceGroup& group, const Vector3d& u, const Vector3d& v) {
+    const Vertex* vertices = mesh.vertices.data();
+    vector<Point2D> scratch;
+    double total = 0;
+    forEachFace<N>(group, [&](const int* idx, int n, int) {
+        Point2D fixed[N > 0 ? N : 1];
+        Point2D* points = fixed;
+        if (N == 0) {
+            scratch.resize(n);
+            points = scratch.data();
+        }
+        projectFace<N>(vertices, idx, n, u, v, points);
+
+        // Shoelace area; positive when the face points along u x v
+        const int count = faceArity<N>(n);
+        double twice = 0;
+        for (int i = 0; i < count; ++i) {
+            const Point2D& a = points[i];
+            const Point2D& b = points[i + 1 < count ? i + 1 : 0];
+            twice += a.u * b.v - b.u * a.v;
+        }
+        if (twice > 0) total += twice / 2.0;
+    });
+    return total;
+}
+
+double meshProjectedArea(const FaceMesh& mesh, double A, double B, double C) {
+    Vector3d u, v;
+    planeBasis(A, B, C, u, v);
+    return groupProjectedArea<3>(mesh, mesh.triangles, u, v) + groupProjectedArea<4>(mesh, mesh.quads, u, v) +
+           groupProjectedArea<0>(mesh, mesh.polygons, u, v);
+}
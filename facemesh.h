@@ -0,0 +1,199 @@
+#ifndef FACEMESH_H
+#define FACEMESH_H
+
+#include "geometry.h"
+#include "projections.h"
+
+// Faces of one arity, stored as flat vertex-index runs in winding order
+struct FaceGroup {
+    vector<int> indices;
+    vector<int> starts;   // Polygon group only: offset of each face in indices, plus an end sentinel
+    vector<int> faceIds;  // Position of each face in Polyhedron::faces
+
+    size_t size() const { return faceIds.size(); }
+};
+
+// One shell with its faces split into triangles, quads and general polygons,
+// so each group runs a kernel whose vertex count is a compile-time constant
+struct FaceMesh {
+    vector<Vertex> vertices;
+    FaceGroup triangles;
+    FaceGroup quads;
+    FaceGroup polygons;   // Faces with more than four vertices, or fewer than three, which the kernels skip
+    vector<FaceMesh> holes;
+
+    bool trianglesOnly() const { return quads.size() == 0 && polygons.size() == 0; }
+};
+
+// Takes each face's loop from Edge::i1; holes are grouped recursively unless includeHoles is false
+FaceMesh buildFaceMesh(const Polyhedron& poly, bool includeHoles = true);
+
+// Face kernels. N is the face arity, or 0 for the general polygon path where
+// the run-time count n is used instead. For N = 3 and N = 4 every loop has a
+// constant trip count and unrolls; nothing branches on the edge count.
+template <int N>
+inline int faceArity(int n) { return N > 0 ? N : n; }
+
+// (b - a) x (c - a), kept inline here so the kernels do not call out to geometry.cpp
+inline Vertex spanCross(const Vertex& a, const Vertex& b, const Vertex& c) {
+    double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    return {uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx};
+}
+
+// Twice the area vector (fan of cross products about the first vertex), so
+// fan triangles falling outside a non-convex face cancel
+template <int N>
+inline Vertex faceVectorArea(const Vertex* vertices, const int* idx, int n) {
+    const int count = faceArity<N>(n);
+    Vertex sum = {0, 0, 0};
+    if (count < 3) return sum;  // Degenerate faces land in the polygon group; they enclose nothing
+    const Vertex& p0 = vertices[idx[0]];
+    for (int i = 1; i + 1 < count; ++i) {
+        Vertex c = spanCross(p0, vertices[idx[i]], vertices[idx[i + 1]]);
+        sum.x += c.x;
+        sum.y += c.y;
+        sum.z += c.z;
+    }
+    return sum;
+}
+
+// Adds the signed volume, first moments and second moments of the fan of
+// tetrahedra between the origin and this face
+template <int N>
+inline void accumulateFaceIntegrals(const Vertex* vertices, const int* idx, int n, const Vertex& origin, VolumeIntegrals& sums) {
+    const int count = faceArity<N>(n);
+    if (count < 3) return;
+    const Vertex& p0 = vertices[idx[0]];
+    Vertex a = {p0.x - origin.x, p0.y - origin.y, p0.z - origin.z};
+    for (int i = 1; i + 1 < count; ++i) {
+        const Vertex& p1 = vertices[idx[i]];
+        const Vertex& p2 = vertices[idx[i + 1]];
+        Vertex b = {p1.x - origin.x, p1.y - origin.y, p1.z - origin.z};
+        Vertex c = {p2.x - origin.x, p2.y - origin.y, p2.z - origin.z};
+        double v = (a.x * (b.y * c.z - b.z * c.y) - a.y * (b.x * c.z - b.z * c.x) + a.z * (b.x * c.y - b.y * c.x)) / 6.0;
+
+        double p[3][3] = {{a.x, a.y, a.z}, {b.x, b.y, b.z}, {c.x, c.y, c.z}};
+        double S[3] = {a.x + b.x + c.x, a.y + b.y + c.y, a.z + b.z + c.z};
+        sums.volume += v;
+        for (int r = 0; r < 3; ++r) {
+            sums.first[r] += v * S[r] / 4.0;
+            for (int q = r; q < 3; ++q) {
+                sums.second[r][q] += v * (p[0][r] * p[0][q] + p[1][r] * p[1][q] + p[2][r] * p[2][q] + S[r] * S[q]) / 20.0;
+            }
+        }
+    }
+}
+
+// Same tests as checkCollinearity on each run of three consecutive vertices
+template <int N>
+inline bool faceHasCollinearRun(const Vertex* vertices, const int* idx, int n) {
+    const int count = faceArity<N>(n);
+    for (int k = 0; k + 2 < count; ++k) {
+        const Vertex& p1 = vertices[idx[k]];
+        const Vertex& p2 = vertices[idx[k + 1]];
+        const Vertex& p3 = vertices[idx[k + 2]];
+        // (p2 - p1) x (p3 - p2) equals (p2 - p1) x (p3 - p1)
+        Vertex c = spanCross(p1, p2, p3);
+        if (std::sqrt(c.x * c.x + c.y * c.y + c.z * c.z) < 1e-6) return true;
+    }
+    return false;
+}
+
+// Same test as checkPlanarity: every vertex on the plane of the first three
+template <int N>
+inline bool faceIsPlanar(const Vertex* vertices, const int* idx, int n) {
+    const int count = faceArity<N>(n);
+    if (count < 3) return true;
+    const Vertex& p0 = vertices[idx[0]];
+    Vertex normal = spanCross(p0, vertices[idx[1]], vertices[idx[2]]);
+    if (std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z) < 1e-6) return false;
+    for (int i = 3; i < count; ++i) {
+        const Vertex& p = vertices[idx[i]];
+        if (std::fabs(normal.x * (p.x - p0.x) + normal.y * (p.y - p0.y) + normal.z * (p.z - p0.z)) > 1e-6) return false;
+    }
+    return true;
+}
+
+// Writes the face loop in the (u, v) coordinates of a projection plane
+template <int N>
+inline void projectFace(const Vertex* vertices, const int* idx, int n, const Vector3d& u, const Vector3d& v, Point2D* out) {
+    const int count = faceArity<N>(n);
+    for (int i = 0; i < count; ++i) {
+        const Vertex& p = vertices[idx[i]];
+        out[i].u = p.x * u.x() + p.y * u.y() + p.z * u.z();
+        out[i].v = p.x * v.x() + p.y * v.y() + p.z * v.z();
+    }
+}
+
+// Möller-Trumbore: whether origin + t dir meets the triangle (a, b, c), with
+// the ray parameter in t. A ray parallel to the triangle's plane misses it;
+// with a tolerance, so does one within tolerance of parallel, relative to
+// the lengths of dir and the two edges from a.
+inline bool rayHitsTriangle(const Vector3d& origin, const Vector3d& dir, const Vector3d& a, const Vector3d& b,
+                            const Vector3d& c, double& t, double tolerance = 0) {
+    Vector3d e1 = b - a, e2 = c - a;
+    Vector3d h = dir.cross(e2);
+    double det = e1.dot(h);
+    if (det == 0 || (tolerance > 0 && std::fabs(det) <= tolerance * dir.norm() * e1.norm() * e2.norm())) return false;
+    Vector3d s = origin - a;
+    double u = s.dot(h) / det;
+    if (u < 0 || u > 1) return false;
+    Vector3d r = s.cross(e1);
+    double v = dir.dot(r) / det;
+    if (v < 0 || u + v > 1) return false;
+    t = e2.dot(r) / det;
+    return true;
+}
+
+// Ray-parity inside tests cast along this: unit length, off every axis and diagonal
+inline Vector3d parityRayDirection() {
+    return Vector3d(0.6, 0.48, 0.64);
+}
+
+// Calls fn(idx, n, faceId) for faces [begin, end) of the group; idx points at n vertex indices
+template <int N, typename Fn>
+inline void forEachFace(const FaceGroup& group, size_t begin, size_t end, Fn fn) {
+    for (size_t f = begin; f < end; ++f) {
+        if (N > 0) {
+            fn(&group.indices[f * N], N, group.faceIds[f]);
+        } else {
+            fn(&group.indices[group.starts[f]], group.starts[f + 1] - group.starts[f], group.faceIds[f]);
+        }
+    }
+}
+
+template <int N, typename Fn>
+inline void forEachFace(const FaceGroup& group, Fn fn) {
+    forEachFace<N>(group, 0, group.size(), fn);
+}
+
+struct TaskState;
+
+// Lets a background task cancel a kernel pass part way. The mesh-level sums
+// run their groups in blocks of KERNEL_BLOCK_FACES faces; after each block
+// they call checkCancelled and report done / total faces as the span
+// [from, to] of the task's progress.
+struct KernelProgress {
+    TaskState* state;
+    size_t total;
+    size_t done;
+    double from, to;
+
+    KernelProgress(TaskState* taskState, size_t totalFaces, double start, double end)
+        : state(taskState), total(totalFaces), done(0), from(start), to(end) {}
+    void advance(size_t faces);
+};
+
+const size_t KERNEL_BLOCK_FACES = 4096;
+
+size_t meshFaceCount(const FaceMesh& mesh);  // Holes included
+
+// Mesh-level sums, dispatched to the N = 3, 4 and general kernels per group
+float meshSurfaceArea(const FaceMesh& mesh, KernelProgress* progress = nullptr);  // Outer shell only
+void accumulateMeshIntegrals(const FaceMesh& mesh, const Vertex& origin, VolumeIntegrals& sums,
+                             KernelProgress* progress = nullptr);                   // Holes included
+// Projected area of the faces facing along (A, B, C); the silhouette area for a convex shell
+double meshProjectedArea(const FaceMesh& mesh, double A, double B, double C);
+
+#endif
@@ -1,8 +1,12 @@
 #include "geometry.h"
+#include "facemesh.h"
 
 using namespace std;
 using namespace Eigen;
 
+// Defaults used by the mass-property helpers that do not take them explicitly
+Vertex origin = {0, 0, 0};
+double density = 1.0;
 
 Vertex vectorSubtract(const Vertex& a, const Vertex& b) { // const ensures that the input arguments a and b are read-only within the function
     return {a.x - b.x, a.y - b.y, a.z - b.z};
@@ -33,6 +37,7 @@ float calculateSurfaceArea(const Polyhedron& poly) {
         if (face.edges.size() < 3) continue;
 
         Vertex v0 = face.edges[0].v1; // Reference vertex for triangles
+        Vertex faceNormal = {0, 0, 0};
 
         for (size_t j = 1; j < face.edges.size() - 1; j++) {
             Vertex v1 = face.edges[j].v1;
@@ -42,12 +47,15 @@ float calculateSurfaceArea(const Polyhedron& poly) {
             Vertex edge1 = vectorSubtract(v1, v0);
             Vertex edge2 = vectorSubtract(v2, v0);
 
-            // Cross product to find the area of the triangle
+            // Sum the signed triangle normals so that fan triangles falling
+            // outside a non-convex face cancel instead of adding area
             Vertex crossProd = vectorCross(edge1, edge2);
-            float triangleArea = vectorMagnitude(crossProd) / 2.0f;
-
-            totalArea += triangleArea;
+            faceNormal.x += crossProd.x;
+            faceNormal.y += crossProd.y;
+            faceNormal.z += crossProd.z;
         }
+
+        totalArea += vectorMagnitude(faceNormal) / 2.0f;
     }
 
     return totalArea;
@@ -75,23 +83,30 @@ double tetrahedronVolume(const Vertex& a, const Vertex& b, const Vertex& c, cons
     return fabs(volume) / 6.0;
 }
 
+// Signed volume of the tetrahedron (apex, a, b, c); positive when the triangle
+// a-b-c winds counter-clockwise seen from outside, i.e. its normal faces away from apex
+double signedTetrahedronVolume(const Vertex& apex, const Vertex& a, const Vertex& b, const Vertex& c) {
+    return vectorDot(vectorSubtract(a, apex), vectorCross(vectorSubtract(b, apex), vectorSubtract(c, apex))) / 6.0;
+}
+
 double calculatepolyhedronVolume(const Polyhedron& poly) {
     double volume = 0.0;
     Vertex centroid = calculateCentroid(poly);
     
-    // Decompose each face into tetrahedrons using the centroid
+    // Decompose each face into tetrahedrons using the centroid; the signs make
+    // this exact for non-convex shells as long as the faces are consistently oriented
     for (const Face& face : poly.faces) {
         const Vertex& v1 = face.edges[0].v1;
-        for (size_t i = 1; i < face.edges.size() - 1; ++i) {
+        for (size_t i = 1; i + 1 < face.edges.size(); ++i) {
             const Vertex& v2 = face.edges[i].v1;
             const Vertex& v3 = face.edges[i + 1].v1;
-            volume += tetrahedronVolume(centroid, v1, v2, v3);
+            volume += signedTetrahedronVolume(centroid, v1, v2, v3);
         }
     }
     
-    // Subtract volumes of sub-polyhedrons
+    // Holes face inwards, so their signed volumes are already negative
     for (const Polyhedron& subPoly : poly.sub_polyhedrons) {
-        volume -= calculatepolyhedronVolume(subPoly);
+        volume += calculatepolyhedronVolume(subPoly);
     }
     
     return volume;
@@ -130,7 +145,7 @@ float calculatePolyhedronVolumeAndCenter(const Polyhedron& poly, Vertex& weighte
             Vertex v1 = face.edges[j].v1;
             Vertex v2 = face.edges[j + 1].v1;
 
-            float tetrahedronVolume = calculateTetrahedronVolume(origin, v0, v1, v2);
+            float tetrahedronVolume = signedTetrahedronVolume(origin, v0, v1, v2);
             Vertex tetrahedronCentroid = calculateTetrahedronCentroid(v0, v1, v2);
 
             // Accumulate volume-weighted centroid
@@ -152,16 +167,15 @@ Vertex calculateCenterOfMass(const Polyhedron& poly) {
     float totalVolume = outerVolume;
     Vertex totalWeightedCenter = outerWeightedCenter;
 
-    // Subtract the contribution of each sub-polyhedron (hole)
+    // Add the contribution of each sub-polyhedron (hole); its inward faces make it negative
     for (const auto& hole : poly.sub_polyhedrons) {
         Vertex holeWeightedCenter = {0, 0, 0};
         float holeVolume = calculatePolyhedronVolumeAndCenter(hole, holeWeightedCenter);
 
-        // Adjust the total volume and weighted center to "subtract" the hole's effect
-        totalVolume -= holeVolume;
-        totalWeightedCenter.x -= holeWeightedCenter.x;
-        totalWeightedCenter.y -= holeWeightedCenter.y;
-        totalWeightedCenter.z -= holeWeightedCenter.z;
+        totalVolume += holeVolume;
+        totalWeightedCenter.x += holeWeightedCenter.x;
+        totalWeightedCenter.y += holeWeightedCenter.y;
+        totalWeightedCenter.z += holeWeightedCenter.z;
     }
 
     // Compute the final center of mass by dividing the weighted sum by the total volume
@@ -187,30 +201,45 @@ double calctetrahedronVolume(const Vertex& v1, const Vertex& v2, const Vertex& v
                 (v1.z - origin.z) * ((v2.x - origin.x) * (v3.y - origin.y) - (v2.y - origin.y) * (v3.x - origin.x))) / 6.0;
 }
 
-// Helper function to compute the inertia tensor of a single tetrahedron
-InertiaTensor computeTetrahedronInertia(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin, double density) {
+// Helper function to compute the inertia tensor of a single tetrahedron of the given mass
+static InertiaTensor tetrahedronInertia(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin, double mass) {
     InertiaTensor tensor;
 
-    // Compute the volume of the tetrahedron
-    double volume = calctetrahedronVolume(v1, v2, v3, origin);
-    double mass = density * volume;
-
     // Compute inertia tensor components for the tetrahedron
     double x1 = v1.x - origin.x, y1 = v1.y - origin.y, z1 = v1.z - origin.z;
     double x2 = v2.x - origin.x, y2 = v2.y - origin.y, z2 = v2.z - origin.z;
     double x3 = v3.x - origin.x, y3 = v3.y - origin.y, z3 = v3.z - origin.z;
 
-    tensor.Ixx = mass * (y1 * y1 + z1 * z1 + y2 * y2 + z2 * z2 + y3 * y3 + z3 * z3) / 10.0;
-    tensor.Iyy = mass * (x1 * x1 + z1 * z1 + x2 * x2 + z2 * z2 + x3 * x3 + z3 * z3) / 10.0;
-    tensor.Izz = mass * (x1 * x1 + y1 * y1 + x2 * x2 + y2 * y2 + x3 * x3 + y3 * y3) / 10.0;
+    // Second moments of a tetrahedron with one vertex at the origin:
+    // integral of x_i x_j dm = mass / 20 * (sum_k p_k,i p_k,j + S_i S_j), S = v1 + v2 + v3
+    double sx = x1 + x2 + x3, sy = y1 + y2 + y3, sz = z1 + z2 + z3;
+    double cxx = mass * (x1 * x1 + x2 * x2 + x3 * x3 + sx * sx) / 20.0;
+    double cyy = mass * (y1 * y1 + y2 * y2 + y3 * y3 + sy * sy) / 20.0;
+    double czz = mass * (z1 * z1 + z2 * z2 + z3 * z3 + sz * sz) / 20.0;
+    double cxy = mass * (x1 * y1 + x2 * y2 + x3 * y3 + sx * sy) / 20.0;
+    double cxz = mass * (x1 * z1 + x2 * z2 + x3 * z3 + sx * sz) / 20.0;
+    double cyz = mass * (y1 * z1 + y2 * z2 + y3 * z3 + sy * sz) / 20.0;
 
-    tensor.Ixy = -mass * (x1 * y1 + x2 * y2 + x3 * y3) / 10.0;
-    tensor.Ixz = -mass * (x1 * z1 + x2 * z2 + x3 * z3) / 10.0;
-    tensor.Iyz = -mass * (y1 * z1 + y2 * z2 + y3 * z3) / 10.0;
+    tensor.Ixx = cyy + czz;
+    tensor.Iyy = cxx + czz;
+    tensor.Izz = cxx + cyy;
+
+    tensor.Ixy = -cxy;
+    tensor.Ixz = -cxz;
+    tensor.Iyz = -cyz;
 
     return tensor;
 }
 
+InertiaTensor computeTetrahedronInertia(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin, double density) {
+    return tetrahedronInertia(v1, v2, v3, origin, density * calctetrahedronVolume(v1, v2, v3, origin));
+}
+
+// Same, but with the mass signed by the triangle's orientation as seen from origin
+InertiaTensor computeSignedTetrahedronInertia(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin, double density) {
+    return tetrahedronInertia(v1, v2, v3, origin, density * signedTetrahedronVolume(origin, v1, v2, v3));
+}
+
 // Function to compute moment of inertia for a polyhedron
 InertiaTensor computePolyhedronInertia(const Polyhedron& poly, const Vertex& origin, double density) {
     InertiaTensor total_inertia;
@@ -218,19 +247,144 @@ InertiaTensor computePolyhedronInertia(const Polyhedron& poly, const Vertex& ori
     // Compute the inertia of the main polyhedron
     for (const Face& face : poly.faces) {
         // Assuming the face is already triangulated
-        for (size_t i = 1; i < face.edges.size() - 1; ++i) {
+        for (size_t i = 1; i + 1 < face.edges.size(); ++i) {
             const Vertex& v1 = face.edges[0].v1;
-            const Vertex& v2 = face.edges[i].v2;
-            const Vertex& v3 = face.edges[i + 1].v2;
+            const Vertex& v2 = face.edges[i].v1;
+            const Vertex& v3 = face.edges[i + 1].v1;
 
-            total_inertia += computeTetrahedronInertia(v1, v2, v3, origin, density);
+            total_inertia += computeSignedTetrahedronInertia(v1, v2, v3, origin, density);
         }
     }
 
-    // Subtract the inertia of each hole
+    // Add the inertia of each hole; its inward faces give it negative mass
     for (const Polyhedron& hole : poly.sub_polyhedrons) {
-        total_inertia -= computePolyhedronInertia(hole, origin, density);
+        total_inertia += computePolyhedronInertia(hole, origin, density);
     }
 
     return total_inertia;
-}
\ No newline at end of file
+}
+static InertiaTensor inertiaFromSecondMoments(const double C[3][3], double density) {
+    InertiaTensor tensor;
+    tensor.Ixx = density * (C[1][1] + C[2][2]);
+    tensor.Iyy = density * (C[0][0] + C[2][2]);
+    tensor.Izz = density * (C[0][0] + C[1][1]);
+    tensor.Ixy = -density * C[0][1];
+    tensor.Ixz = -density * C[0][2];
+    tensor.Iyz = -density * C[1][2];
+    return tensor;
+}
+
+InertiaTensor inertiaFromIntegrals(const VolumeIntegrals& sums, double density) {
+    return inertiaFromSecondMoments(sums.second, density);
+}
+
+Vertex centerOfMassFromIntegrals(const VolumeIntegrals& sums, const Vertex& origin) {
+    // Same conventions as calculateCenterOfMass
+    if (sums.volume <= 0) return {0, 0, 0};
+    Vertex centre = {origin.x + sums.first[0] / sums.volume, origin.y + sums.first[1] / sums.volume, origin.z + sums.first[2] / sums.volume};
+    if (std::fabs(centre.x) < EPSILON) centre.x = 0;
+    if (std::fabs(centre.y) < EPSILON) centre.y = 0;
+    if (std::fabs(centre.z) < EPSILON) centre.z = 0;
+    return centre;
+}
+
+MassProperties massPropertiesFromIntegrals(VolumeIntegrals sums, const Vertex& origin, double density) {
+    MassProperties props;
+    sums.symmetrize();
+
+    props.volume = sums.volume;
+    props.mass = density * sums.volume;
+    props.inertia = inertiaFromIntegrals(sums, density);
+
+    // Shift the second moments to the centre of mass: C_c = C - V d d^T
+    double d[3] = {0, 0, 0};
+    if (sums.volume != 0) {
+        for (int r = 0; r < 3; ++r) d[r] = sums.first[r] / sums.volume;
+    }
+    props.centerOfMass = {origin.x + d[0], origin.y + d[1], origin.z + d[2]};
+    double central[3][3];
+    for (int r = 0; r < 3; ++r) {
+        for (int q = 0; q < 3; ++q) central[r][q] = sums.second[r][q] - sums.volume * d[r] * d[q];
+    }
+    props.centralInertia = inertiaFromSecondMoments(central, density);
+
+    // computeDirect is Eigen's closed-form (trigonometric) 3x3 symmetric solver
+    const InertiaTensor& I = props.centralInertia;
+    Matrix3d tensor;
+    tensor << I.Ixx, I.Ixy, I.Ixz,
+              I.Ixy, I.Iyy, I.Iyz,
+              I.Ixz, I.Iyz, I.Izz;
+    SelfAdjointEigenSolver<Matrix3d> solver;
+    solver.computeDirect(tensor);
+    Matrix3d axes = solver.eigenvectors();
+    Vector3d moments = solver.eigenvalues();
+
+    // Repeated moments leave the eigenvectors arbitrary within their eigenspace;
+    // snap to the world axes there so the box of a cube is not rotated at random
+    double scale = max(fabs(moments(0)), fabs(moments(2)));
+    bool lowPair = moments(1) - moments(0) <= 1e-9 * scale;
+    bool highPair = moments(2) - moments(1) <= 1e-9 * scale;
+    if (lowPair && highPair) {
+        axes.setIdentity();
+    } else if (lowPair || highPair) {
+        int distinct = lowPair ? 2 : 0;
+        Vector3d e = axes.col(distinct);
+        int world = 0;
+        for (int k = 1; k < 3; ++k) {
+            if (fabs(e(k)) < fabs(e(world))) world = k;
+        }
+        Vector3d u = Vector3d::Unit(world) - e(world) * e;
+        u.normalize();
+        axes.col(lowPair ? 0 : 1) = u;
+        axes.col(lowPair ? 1 : 2) = e.cross(u);
+    }
+    if (axes.determinant() < 0) axes.col(2) = -axes.col(2);
+    for (int k = 0; k < 3; ++k) {
+        props.principalMoments[k] = moments(k);
+        props.principalAxes[k] = {axes(0, k), axes(1, k), axes(2, k)};
+    }
+    fitOrientedBox(props, nullptr, 0);
+    return props;
+}
+
+void fitOrientedBox(MassProperties& props, const vector<Vertex>& points) {
+    fitOrientedBox(props, points.data(), points.size());
+}
+
+void fitOrientedBox(MassProperties& props, const Vertex* points, size_t count) {
+    double lo[3], hi[3];
+    for (int k = 0; k < 3; ++k) {
+        lo[k] = numeric_limits<double>::max();
+        hi[k] = -numeric_limits<double>::max();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex& v = points[i];
+        for (int k = 0; k < 3; ++k) {
+            const Vertex& axis = props.principalAxes[k];
+            double t = v.x * axis.x + v.y * axis.y + v.z * axis.z;
+            lo[k] = min(lo[k], t);
+            hi[k] = max(hi[k], t);
+        }
+    }
+    props.box.center = {0, 0, 0};
+    for (int k = 0; k < 3; ++k) {
+        props.box.axes[k] = props.principalAxes[k];
+        if (count == 0) {
+            lo[k] = hi[k] = 0;
+        }
+        props.box.halfExtents[k] = (hi[k] - lo[k]) / 2.0;
+        double mid = (hi[k] + lo[k]) / 2.0;
+        props.box.center.x += mid * props.principalAxes[k].x;
+        props.box.center.y += mid * props.principalAxes[k].y;
+        props.box.center.z += mid * props.principalAxes[k].z;
+    }
+}
+
+MassProperties computeMassProperties(const Polyhedron& poly, const Vertex& origin, double density) {
+    VolumeIntegrals sums;
+    accumulateMeshIntegrals(buildFaceMesh(poly), origin, sums);
+    MassProperties props = massPropertiesFromIntegrals(sums, origin, density);
+    // Extents along the principal axes; holes lie inside the outer shell
+    fitOrientedBox(props, poly.vertices);
+    return props;
+}
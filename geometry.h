@@ -12,13 +12,69 @@ Vertex vectorCross(const Vertex& a, const Vertex& b);
 float vectorMagnitude(const Vertex& v);
 Vertex calculateCentroid(const Polyhedron& poly);
 double tetrahedronVolume(const Vertex& a, const Vertex& b, const Vertex& c, const Vertex& d);
+double signedTetrahedronVolume(const Vertex& apex, const Vertex& a, const Vertex& b, const Vertex& c);
+Vertex calculateTetrahedronCentroid(const Vertex& v0, const Vertex& v1, const Vertex& v2);
+float calculateTetrahedronVolume(const Vertex& origin, const Vertex& v1, const Vertex& v2, const Vertex& v3);
 double calctetrahedronVolume(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin);
 InertiaTensor computeTetrahedronInertia(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin, double density);
+InertiaTensor computeSignedTetrahedronInertia(const Vertex& v1, const Vertex& v2, const Vertex& v3, const Vertex& origin, double density);
+
+// The polyhedron-level functions below use signed volumes and expect faces
+// oriented by orientPolyhedron: holes then contribute negatively on their own
 
 double calculatepolyhedronVolume(const Polyhedron& poly);
 Vertex calculateCenterOfMass(const Polyhedron& poly);
 float calculateSurfaceArea(const Polyhedron& poly);
 InertiaTensor computePolyhedronInertia(const Polyhedron& poly, const Vertex& origin, double density);
 
+// Running volume integrals relative to an origin: volume, first moments and
+// the second-moment matrix C_ij = integral of x_i x_j dV (upper triangle
+// until symmetrize() is called)
+struct VolumeIntegrals {
+    double volume;
+    double first[3];
+    double second[3][3];
+
+    VolumeIntegrals() : volume(0), first(), second() {}
+    void symmetrize() {
+        for (int r = 0; r < 3; ++r) {
+            for (int q = 0; q < r; ++q) second[r][q] = second[q][r];
+        }
+    }
+};
+
+// Inertia about the integration origin (second moments only need the upper triangle)
+InertiaTensor inertiaFromIntegrals(const VolumeIntegrals& sums, double density);
+// Absolute centre of mass; zero for a shell with no positive volume
+Vertex centerOfMassFromIntegrals(const VolumeIntegrals& sums, const Vertex& origin);
+
+// Box aligned to the principal axes that encloses the outer shell
+struct OrientedBox {
+    Vertex center;
+    Vertex axes[3];        // Unit vectors, same as MassProperties::principalAxes
+    double halfExtents[3];
+};
+
+struct MassProperties {
+    double volume;
+    double mass;
+    Vertex centerOfMass;
+    InertiaTensor inertia;          // About the origin passed in
+    InertiaTensor centralInertia;   // About the centre of mass
+    double principalMoments[3];     // Ascending
+    Vertex principalAxes[3];        // Unit eigenvectors of centralInertia, right-handed
+    OrientedBox box;
+};
+
+// Everything but the box (which is left empty) from integrals taken about `origin`
+MassProperties massPropertiesFromIntegrals(VolumeIntegrals sums, const Vertex& origin, double density);
+// Sets props.box to the extents of `points` along props.principalAxes
+void fitOrientedBox(MassProperties& props, const vector<Vertex>& points);
+void fitOrientedBox(MassProperties& props, const Vertex* points, size_t count);
+
+// Volume, centre of mass and inertia from a single pass over the faces,
+// followed by the principal frame (closed-form 3x3 symmetric eigen-solve)
+// and the oriented bounding box from the outer shell's vertex array
+MassProperties computeMassProperties(const Polyhedron& poly, const Vertex& origin, double density);
 
 #endif
\ No newline at end of file
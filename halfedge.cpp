@@ -0,0 +1,185 @@
+#include "halfedge.h"
+#include "geometry.h"
+
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+
+using namespace std;
+
+HalfEdgeMesh buildHalfEdgeMesh(int numVertices, const vector<int>& faceSizes, const vector<int>& faceIndices) {
+    HalfEdgeMesh mesh;
+    mesh.boundaryEdges = 0;
+    mesh.nonManifoldEdges = 0;
+
+    size_t numHalfEdges = faceIndices.size();
+    mesh.faceStart.resize(faceSizes.size() + 1);
+    mesh.origin = faceIndices;
+    mesh.next.resize(numHalfEdges);
+    mesh.twin.assign(numHalfEdges, -1);
+    mesh.face.resize(numHalfEdges);
+    mesh.vertexHalfEdge.assign(numVertices, -1);
+
+    int h = 0;
+    for (size_t f = 0; f < faceSizes.size(); ++f) {
+        mesh.faceStart[f] = h;
+        int n = faceSizes[f];
+        for (int j = 0; j < n; ++j) {
+            mesh.next[h + j] = h + (j + 1) % n;
+            mesh.face[h + j] = static_cast<int>(f);
+            if (mesh.vertexHalfEdge[mesh.origin[h + j]] < 0) mesh.vertexHalfEdge[mesh.origin[h + j]] = h + j;
+        }
+        h += n;
+    }
+    mesh.faceStart[faceSizes.size()] = h;
+
+    // Pair half-edges on the same undirected edge. The map holds the first
+    // half-edge seen per edge, or -1 once a third one shows up (non-manifold).
+    unordered_map<uint64_t, int> firstSeen;
+    firstSeen.reserve(numHalfEdges);
+    for (int e = 0; e < static_cast<int>(numHalfEdges); ++e) {
+        uint32_t a = mesh.origin[e], b = mesh.dest(e);
+        if (a == b) continue;
+        uint64_t key = (static_cast<uint64_t>(min(a, b)) << 32) | max(a, b);
+
+        auto ins = firstSeen.insert(make_pair(key, e));
+        if (ins.second) continue;
+        int& g = ins.first->second;
+        if (g < 0) continue;
+        if (mesh.twin[g] < 0) {
+            mesh.twin[g] = e;
+            mesh.twin[e] = g;
+        } else {
+            mesh.twin[mesh.twin[g]] = -1;
+            mesh.twin[g] = -1;
+            g = -1;
+            mesh.nonManifoldEdges++;
+        }
+    }
+    for (const auto& entry : firstSeen) {
+        if (entry.second >= 0 && mesh.twin[entry.second] < 0) mesh.boundaryEdges++;
+    }
+    return mesh;
+}
+
+HalfEdgeMesh buildHalfEdgeMesh(const Polyhedron& poly) {
+    vector<int> faceSizes;
+    vector<int> faceIndices;
+    faceSizes.reserve(poly.faces.size());
+    for (const auto& face : poly.faces) {
+        faceSizes.push_back(static_cast<int>(face.edges.size()));
+        for (const auto& edge : face.edges) {
+            faceIndices.push_back(edge.i1);
+        }
+    }
+    return buildHalfEdgeMesh(static_cast<int>(poly.vertices.size()), faceSizes, faceIndices);
+}
+
+vector<int> vertexOneRing(const HalfEdgeMesh& mesh, int v) {
+    vector<int> ring;
+    int start = mesh.vertexHalfEdge[v];
+    if (start < 0) return ring;
+
+    // Walk outgoing half-edges: twin(h) comes back into v, next of that leaves v again
+    int h = start;
+    do {
+        ring.push_back(mesh.dest(h));
+        int back = mesh.twin[h];
+        if (back < 0) break;
+        h = mesh.next[back];
+    } while (h != start);
+    return ring;
+}
+
+// Reverse the loop of a face while keeping its first vertex in place
+static void flipFace(Face& face) {
+    reverse(face.edges.begin(), face.edges.end());
+    for (auto& edge : face.edges) {
+        swap(edge.v1, edge.v2);
+        swap(edge.i1, edge.i2);
+    }
+}
+
+vector<char> orientationFlips(const HalfEdgeMesh& mesh, const Vertex* vertices, int depth, OrientationReport& report) {
+    report.openEdges += mesh.boundaryEdges + mesh.nonManifoldEdges;
+
+    int numFaces = mesh.numFaces();
+    vector<int> component(numFaces, -1);
+    vector<char> flip(numFaces, 0);
+    double wantSign = (depth % 2 == 0) ? 1.0 : -1.0;
+
+    for (int seed = 0; seed < numFaces; ++seed) {
+        if (component[seed] >= 0) continue;
+        int id = static_cast<int>(report.shells++);
+        bool orientable = true;
+        vector<int> members;
+
+        // Two faces agree when they traverse their shared edge in opposite
+        // directions; otherwise one of them has to be flipped
+        queue<int> pending;
+        pending.push(seed);
+        component[seed] = id;
+        while (!pending.empty()) {
+            int f = pending.front();
+            pending.pop();
+            members.push_back(f);
+            for (int h = mesh.faceStart[f]; h < mesh.faceStart[f + 1]; ++h) {
+                int g = mesh.neighbour(h);
+                if (g < 0) continue;
+                char sameDirection = mesh.origin[mesh.twin[h]] == mesh.origin[h];
+                char wanted = flip[f] ^ sameDirection;
+                if (component[g] < 0) {
+                    component[g] = id;
+                    flip[g] = wanted;
+                    pending.push(g);
+                } else if (flip[g] != wanted) {
+                    orientable = false;
+                }
+            }
+        }
+        if (!orientable) report.nonOrientableShells++;
+
+        // Signed volume of the now consistent shell decides which way it faces
+        const Vertex& apex = vertices[mesh.origin[mesh.faceStart[seed]]];
+        double volume = 0.0;
+        for (int f : members) {
+            int first = mesh.faceStart[f], end = mesh.faceStart[f + 1];
+            double faceVolume = 0.0;
+            for (int h = first + 1; h + 1 < end; ++h) {
+                faceVolume += signedTetrahedronVolume(apex, vertices[mesh.origin[first]], vertices[mesh.origin[h]],
+                                                      vertices[mesh.origin[h + 1]]);
+            }
+            volume += flip[f] ? -faceVolume : faceVolume;
+        }
+        if (volume * wantSign < 0) {
+            for (int f : members) flip[f] ^= 1;
+        }
+    }
+    return flip;
+}
+
+OrientationReport orientPolyhedron(Polyhedron& poly, int depth) {
+    OrientationReport report;
+    HalfEdgeMesh mesh = buildHalfEdgeMesh(poly);
+    vector<char> flip = orientationFlips(mesh, poly.vertices.data(), depth, report);
+    for (size_t f = 0; f < flip.size(); ++f) {
+        if (flip[f]) {
+            flipFace(poly.faces[f]);
+            report.facesFlipped++;
+        }
+    }
+
+    for (auto& sub : poly.sub_polyhedrons) {
+        OrientationReport subReport = orientPolyhedron(sub, depth + 1);
+        report.shells += subReport.shells;
+        report.facesFlipped += subReport.facesFlipped;
+        report.nonOrientableShells += subReport.nonOrientableShells;
+        report.openEdges += subReport.openEdges;
+    }
+    return report;
+}
+
+void printOrientationReport(const OrientationReport& report) {
+    printf("Oriented %zu shell(s): %zu faces flipped, %zu non-orientable shell(s), %zu open edges\n",
+           report.shells, report.facesFlipped, report.nonOrientableShells, report.openEdges);
+}
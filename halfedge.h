@@ -0,0 +1,57 @@
+#ifndef HALFEDGE_H
+#define HALFEDGE_H
+
+#include "input.h"
+
+// Half-edge connectivity for one shell. The half-edges of face f are stored
+// contiguously in [faceStart[f], faceStart[f + 1]) in winding order, so every
+// query below is O(1) array lookups. twin is -1 on boundary edges and on
+// non-manifold edges shared by more than two faces.
+struct HalfEdgeMesh {
+    vector<int> faceStart;      // size numFaces + 1
+    vector<int> origin;         // vertex each half-edge leaves from
+    vector<int> next;
+    vector<int> twin;
+    vector<int> face;
+    vector<int> vertexHalfEdge; // one outgoing half-edge per vertex, -1 if unused
+    size_t boundaryEdges;
+    size_t nonManifoldEdges;
+
+    int numFaces() const { return static_cast<int>(faceStart.size()) - 1; }
+    int dest(int h) const { return origin[next[h]]; }
+    // Neighbouring face across half-edge h, or -1
+    int neighbour(int h) const { return twin[h] < 0 ? -1 : face[twin[h]]; }
+};
+
+// Builds the structure in linear expected time from flat buffers: faceSizes[f]
+// vertex indices of face f are stored consecutively in faceIndices
+HalfEdgeMesh buildHalfEdgeMesh(int numVertices, const vector<int>& faceSizes, const vector<int>& faceIndices);
+// Same, taking each face's loop from Edge::i1 of the shell's own faces (holes are not included)
+HalfEdgeMesh buildHalfEdgeMesh(const Polyhedron& poly);
+
+// Vertices adjacent to v, walking its fan of faces (stops early at a boundary)
+vector<int> vertexOneRing(const HalfEdgeMesh& mesh, int v);
+
+struct OrientationReport {
+    size_t shells;            // connected face components over all levels
+    size_t facesFlipped;
+    size_t nonOrientableShells;
+    size_t openEdges;         // boundary plus non-manifold edges
+
+    OrientationReport() : shells(0), facesFlipped(0), nonOrientableShells(0), openEdges(0) {}
+};
+
+// Makes the winding of every face consistent with its neighbours (BFS over
+// twins) and then orients each connected shell so that its signed volume is
+// positive at even depths (the outer shell faces outward) and negative at odd
+// depths (holes face into the cavity). Faces are flipped in place.
+OrientationReport orientPolyhedron(Polyhedron& poly, int depth = 0);
+
+// The same decision for one shell without touching it: flip[f] is set for
+// every face orientPolyhedron would reverse. Shells, non-orientable shells
+// and open edges are added to `report`; facesFlipped is left to the caller.
+vector<char> orientationFlips(const HalfEdgeMesh& mesh, const Vertex* vertices, int depth, OrientationReport& report);
+
+void printOrientationReport(const OrientationReport& report);
+
+#endif
@@ -0,0 +1,239 @@
+#include "history.h"
+#include "transformations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using namespace std;
+
+void applyTransformOp(const TransformOp& op, Vertex* vertices, size_t count) {
+    const double* p = op.params;
+    for (size_t i = 0; i < count; ++i) {
+        switch (op.kind) {
+            case TRANSFORM_ROTATE: rotate_point(&vertices[i], p[0], p[1], p[2], p[3]); break;
+            case TRANSFORM_TRANSLATE: translate_point(&vertices[i], p[0], p[1], p[2]); break;
+            case TRANSFORM_SCALE: scale_point(&vertices[i], p[0], p[1], p[2]); break;
+            case TRANSFORM_REFLECT: reflect_point(&vertices[i], p[0], p[1], p[2], p[3]); break;
+        }
+    }
+}
+
+double applyTransformOps(const vector<TransformOp>& ops, size_t steps, Vertex* vertices, size_t count) {
+    // Every operation is affine, so the images of the origin and the unit
+    // points fix the composed map
+    Vertex frame[4] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    double stretch = 1.0;
+    for (size_t i = 0; i < steps; ++i) {
+        applyTransformOp(ops[i], frame, 4);
+        if (ops[i].kind == TRANSFORM_SCALE) {
+            const double* p = ops[i].params;
+            stretch *= max(fabs(p[0]), max(fabs(p[1]), fabs(p[2])));
+        }
+    }
+    const Vertex& o = frame[0];
+    Vertex ex = {frame[1].x - o.x, frame[1].y - o.y, frame[1].z - o.z};
+    Vertex ey = {frame[2].x - o.x, frame[2].y - o.y, frame[2].z - o.z};
+    Vertex ez = {frame[3].x - o.x, frame[3].y - o.y, frame[3].z - o.z};
+    for (size_t i = 0; i < count; ++i) {
+        Vertex v = vertices[i];
+        vertices[i].x = o.x + v.x * ex.x + v.y * ey.x + v.z * ez.x;
+        vertices[i].y = o.y + v.x * ex.y + v.y * ey.y + v.z * ez.y;
+        vertices[i].z = o.z + v.x * ex.z + v.y * ey.z + v.z * ez.z;
+    }
+    return stretch;
+}
+
+string describeTransformOp(const TransformOp& op) {
+    const double* p = op.params;
+    char text[160];
+    switch (op.kind) {
+        case TRANSFORM_ROTATE:
+            snprintf(text, sizeof(text), "Rotate %g degrees about (%g, %g, %g)", p[0], p[1], p[2], p[3]);
+            break;
+        case TRANSFORM_TRANSLATE:
+            snprintf(text, sizeof(text), "Translate by (%g, %g, %g)", p[0], p[1], p[2]);
+            break;
+        case TRANSFORM_SCALE:
+            snprintf(text, sizeof(text), "Scale by (%g, %g, %g)", p[0], p[1], p[2]);
+            break;
+        default:
+            snprintf(text, sizeof(text), "Reflect across %gx + %gy + %gz = %g", p[0], p[1], p[2], p[3]);
+            break;
+    }
+    return text;
+}
+
+// The linear part has a negative determinant, so the operation mirrors the solid
+static bool reversesOrientation(const TransformOp& op) {
+    const double* p = op.params;
+    return op.kind == TRANSFORM_REFLECT || (op.kind == TRANSFORM_SCALE && p[0] * p[1] * p[2] < 0);
+}
+
+// Runs every face loop the other way round, in each shell
+static void reverseFaces(Polyhedron& poly) {
+    for (Face& face : poly.faces) {
+        reverse(face.edges.begin(), face.edges.end());
+        for (Edge& edge : face.edges) {
+            swap(edge.i1, edge.i2);
+        }
+    }
+    for (Polyhedron& sub : poly.sub_polyhedrons) {
+        reverseFaces(sub);
+    }
+}
+
+// Outer shell first, then holes depth-first, as in every other per-shell listing
+static void appendVertices(const Polyhedron& poly, vector<Vertex>& out) {
+    out.insert(out.end(), poly.vertices.begin(), poly.vertices.end());
+    for (const Polyhedron& sub : poly.sub_polyhedrons) {
+        appendVertices(sub, out);
+    }
+}
+
+static void assignVertices(Polyhedron& poly, const Vertex*& next) {
+    for (Vertex& v : poly.vertices) {
+        v = *next++;
+    }
+    for (Polyhedron& sub : poly.sub_polyhedrons) {
+        assignVertices(sub, next);
+    }
+}
+
+TransformHistory::TransformHistory(shared_ptr<const Polyhedron> base)
+    : interval_(HISTORY_SNAPSHOT_INTERVAL), step_(0), current_(base), currentReversed_(false), stale_(false) {
+    appendVertices(*base, working_);
+    takeSnapshot();
+}
+
+void TransformHistory::takeSnapshot() {
+    Snapshot snapshot;
+    snapshot.step = step_;
+    const Snapshot* previous = snapshots_.empty() ? nullptr : &snapshots_.back();
+    for (size_t start = 0, c = 0; start < working_.size(); start += HISTORY_CHUNK_VERTICES, ++c) {
+        size_t count = min(HISTORY_CHUNK_VERTICES, working_.size() - start);
+        if (previous && c < previous->chunks.size()) {
+            const Chunk& old = *previous->chunks[c];
+            if (old.size() == count && memcmp(old.data(), &working_[start], count * sizeof(Vertex)) == 0) {
+                snapshot.chunks.push_back(previous->chunks[c]);
+                continue;
+            }
+        }
+        snapshot.chunks.push_back(make_shared<const Chunk>(working_.begin() + start, working_.begin() + start + count));
+    }
+    snapshots_.push_back(move(snapshot));
+
+    // Keep step 0 and every other snapshot after it, the newest included
+    if (snapshots_.size() > HISTORY_MAX_SNAPSHOTS) {
+        size_t kept = 1;
+        for (size_t i = 2; i < snapshots_.size(); i += 2) {
+            snapshots_[kept++] = move(snapshots_[i]);
+        }
+        snapshots_.resize(kept);
+        interval_ *= 2;
+    }
+}
+
+void TransformHistory::apply(const TransformOp& op) {
+    ops_.erase(ops_.begin() + step_, ops_.end());
+    while (snapshots_.back().step > step_) {
+        snapshots_.pop_back();
+    }
+
+    applyTransformOp(op, working_.data(), working_.size());
+    ops_.push_back(op);
+    ++step_;
+    stale_ = true;
+    if (step_ - snapshots_.back().step >= interval_) {
+        takeSnapshot();
+    }
+}
+
+// Replays from the working vertices when they are on the way to `step`,
+// otherwise from the last snapshot at or before it
+void TransformHistory::restore(size_t step) {
+    size_t s = snapshots_.size() - 1;
+    while (snapshots_[s].step > step) --s;
+    const Snapshot& snapshot = snapshots_[s];
+
+    size_t from = step_;
+    if (step < step_ || snapshot.step > step_) {
+        working_.clear();
+        for (const shared_ptr<const Chunk>& chunk : snapshot.chunks) {
+            working_.insert(working_.end(), chunk->begin(), chunk->end());
+        }
+        from = snapshot.step;
+    }
+    for (size_t i = from; i < step; ++i) {
+        applyTransformOp(ops_[i], working_.data(), working_.size());
+    }
+    step_ = step;
+    stale_ = true;
+}
+
+bool TransformHistory::undo() {
+    return step_ > 0 && jumpTo(step_ - 1);
+}
+
+bool TransformHistory::redo() {
+    return step_ < ops_.size() && jumpTo(step_ + 1);
+}
+
+bool TransformHistory::jumpTo(size_t step) {
+    if (step > ops_.size()) return false;
+    if (step != step_) {
+        restore(step);
+    }
+    return true;
+}
+
+shared_ptr<const Polyhedron> TransformHistory::current() {
+    if (stale_) {
+        // Every version has the same faces, so the last one built supplies
+        // them and no older version has to be kept alive
+        shared_ptr<Polyhedron> rebuilt = make_shared<Polyhedron>(*current_);
+        const Vertex* next = working_.data();
+        assignVertices(*rebuilt, next);
+        bool reversed = false;
+        for (size_t i = 0; i < step_; ++i) {
+            reversed ^= reversesOrientation(ops_[i]);
+        }
+        if (reversed != currentReversed_) {
+            reverseFaces(*rebuilt);
+            currentReversed_ = reversed;
+        }
+        update_edges(*rebuilt);
+        current_ = rebuilt;
+        stale_ = false;
+    }
+    return current_;
+}
+
+MemoryFootprint TransformHistory::footprint() const {
+    MemoryFootprint footprint;
+    accountVector(ops_, footprint.topologyBytes, footprint);
+    accountVector(snapshots_, footprint.topologyBytes, footprint);
+    accountVector(working_, footprint.vertexBytes, footprint);
+    // Shared chunks are counted once
+    unordered_set<const Chunk*> counted;
+    for (const Snapshot& snapshot : snapshots_) {
+        accountVector(snapshot.chunks, footprint.topologyBytes, footprint);
+        for (const shared_ptr<const Chunk>& chunk : snapshot.chunks) {
+            if (counted.insert(chunk.get()).second) {
+                accountVector(*chunk, footprint.vertexBytes, footprint);
+            }
+        }
+    }
+    return footprint;
+}
+
+void printTransformHistory(const TransformHistory& history) {
+    const vector<TransformOp>& ops = history.operations();
+    printf("%s Step 0: as loaded\n", history.step() == 0 ? "->" : "  ");
+    for (size_t i = 0; i < ops.size(); ++i) {
+        printf("%s Step %zu: %s%s\n", history.step() == i + 1 ? "->" : "  ", i + 1, describeTransformOp(ops[i]).c_str(),
+               i < history.step() ? "" : " (undone)");
+    }
+    MemoryFootprint footprint = history.footprint();
+    printf("%zu snapshots, %zu bytes of history\n", history.snapshots(), footprint.totalBytes());
+}
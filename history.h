@@ -0,0 +1,79 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "input.h"
+#include "memory.h"
+
+#include <memory>
+
+enum TransformKind { TRANSFORM_ROTATE, TRANSFORM_TRANSLATE, TRANSFORM_SCALE, TRANSFORM_REFLECT };
+
+// One step of the transformation menu, with the arguments of the matching
+// *_point function: angle A B C, dx dy dz, sx sy sz, or A B C D
+struct TransformOp {
+    TransformKind kind;
+    double params[4];
+};
+
+void applyTransformOp(const TransformOp& op, Vertex* vertices, size_t count);
+// Applies the first `steps` operations at the cost of a single affine map per
+// vertex, however many there are. Returns a bound on how far the map
+// stretches distances.
+double applyTransformOps(const vector<TransformOp>& ops, size_t steps, Vertex* vertices, size_t count);
+string describeTransformOp(const TransformOp& op);
+
+// Committed transformations of one loaded polyhedron, with undo and redo.
+//
+// Transformations only move vertices, so every version shares the loaded
+// polyhedron's topology and only vertex positions are kept: the operations
+// themselves, plus a snapshot of all vertices every few steps. A reflection
+// or a negative scale turns the solid inside out, so versions reached through
+// an odd number of those have every face loop reversed as well.
+// A snapshot is a list of fixed-size chunks, and a chunk equal to the one
+// in the previous snapshot is shared rather than stored again. Reaching
+// any step replays at most the operations since the snapshot before it.
+// Once there are more than HISTORY_MAX_SNAPSHOTS, every other snapshot is
+// dropped and the interval doubles, so a long session costs a bounded
+// number of vertex copies.
+class TransformHistory {
+public:
+    explicit TransformHistory(shared_ptr<const Polyhedron> base);
+
+    void apply(const TransformOp& op);  // Discards any steps that could be redone
+    bool undo();
+    bool redo();
+    bool jumpTo(size_t step);
+
+    size_t step() const { return step_; }          // Operations applied to the current version
+    const vector<TransformOp>& operations() const { return ops_; }
+    size_t snapshots() const { return snapshots_.size(); }
+
+    // The current version, rebuilt on demand and kept until the step changes
+    shared_ptr<const Polyhedron> current();
+
+    // Operations, snapshots and the working vertices; the shared topology is not counted
+    MemoryFootprint footprint() const;
+
+private:
+    typedef vector<Vertex> Chunk;
+    struct Snapshot {
+        size_t step;
+        vector<shared_ptr<const Chunk> > chunks;
+    };
+
+    void takeSnapshot();
+    void restore(size_t step);
+
+    vector<TransformOp> ops_;
+    vector<Snapshot> snapshots_;            // By ascending step; the first is step 0
+    size_t interval_;
+    size_t step_;
+    vector<Vertex> working_;                // All shells' vertices at step_, outer shell first, holes depth-first
+    shared_ptr<const Polyhedron> current_;  // Last version built; also the source of the shared faces
+    bool currentReversed_;                  // current_'s face loops run against the loaded polyhedron's
+    bool stale_;                            // working_ has moved on since current_ was built
+};
+
+void printTransformHistory(const TransformHistory& history);
+
+#endif
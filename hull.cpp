@@ -0,0 +1,466 @@
+#include "hull.h"
+#include "facemesh.h"
+
+#include <thread>
+
+using namespace std;
+using namespace Eigen;
+
+// Below this many points per thread a run is not worth a hull of its own
+static const size_t HULL_PARALLEL_MIN = 16384;
+
+struct HullFace {
+    int v[3];
+    int neighbour[3];        // Across the edge from v[i] to v[(i + 1) % 3]
+    Vertex normal;           // Unit length, outwards
+    double offset;
+    vector<int> outside;     // Points above the face that are still to be added
+    int furthest;            // Entry of outside furthest above the face
+    double furthestDistance;
+    int visited;             // Stamp of the last search that reached the face
+    int visible;             // Stamp of the last search that found the point above it
+    bool alive;
+};
+
+static double distanceAbove(const HullFace& face, const Vertex& p) {
+    return face.normal.x * p.x + face.normal.y * p.y + face.normal.z * p.z - face.offset;
+}
+
+static double distance(const Vertex& a, const Vertex& b) {
+    return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+}
+
+static double length(const Vertex& v) {
+    return sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+// One serial quickhull over an array of points. Faces removed by a point are
+// reused by the next ones, and every scratch list lives as long as the run.
+class QuickHull {
+public:
+    QuickHull(const Vertex* points, size_t count, double eps)
+        : points_(points), count_(count), eps_(eps), stamp_(0), slot_(count, -1) {}
+
+    // Triples of point indices, wound outwards; false if the points do not span three dimensions
+    bool run(vector<int>& triangles);
+
+private:
+    struct HorizonEdge {
+        int a, b;     // As wound in the visible face
+        int across;   // The face beyond it, which stays
+    };
+
+    int addFace(int a, int b, int c);
+    bool buildSimplex();
+    void assign(int point, const int* faces, size_t numFaces);
+    void addFurthestPoint(int f);
+    void dropFurthestPoint(int f);
+
+    const Vertex* points_;
+    size_t count_;
+    double eps_;
+    int stamp_;
+    vector<HullFace> faces_;
+    vector<int> free_;          // Faces removed so far, for reuse
+    vector<int> pending_;       // Faces that may still have points outside them
+    vector<int> slot_;          // Per point: its horizon edge or new face, -1 otherwise
+    vector<int> visible_;
+    vector<HorizonEdge> horizon_;
+    vector<int> orphans_;
+    vector<int> newFaces_;
+};
+
+int QuickHull::addFace(int a, int b, int c) {
+    int id;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    } else {
+        id = static_cast<int>(faces_.size());
+        faces_.push_back(HullFace());
+    }
+    HullFace& face = faces_[id];
+    face.v[0] = a;
+    face.v[1] = b;
+    face.v[2] = c;
+    face.neighbour[0] = face.neighbour[1] = face.neighbour[2] = -1;
+    Vertex n = spanCross(points_[a], points_[b], points_[c]);
+    double len = length(n);
+    if (len > 0) {
+        n.x /= len;
+        n.y /= len;
+        n.z /= len;
+    }
+    face.normal = n;
+    face.offset = n.x * points_[a].x + n.y * points_[a].y + n.z * points_[a].z;
+    face.outside.clear();
+    face.furthest = -1;
+    face.furthestDistance = 0;
+    face.visited = face.visible = 0;
+    face.alive = true;
+    return id;
+}
+
+// To the face the point is furthest above, if it is above any by more than rounding
+void QuickHull::assign(int point, const int* faces, size_t numFaces) {
+    int best = -1;
+    double bestDistance = eps_;
+    for (size_t k = 0; k < numFaces; ++k) {
+        double d = distanceAbove(faces_[faces[k]], points_[point]);
+        if (d > bestDistance) {
+            bestDistance = d;
+            best = faces[k];
+        }
+    }
+    if (best < 0) return;
+    HullFace& face = faces_[best];
+    face.outside.push_back(point);
+    if (bestDistance > face.furthestDistance) {
+        face.furthestDistance = bestDistance;
+        face.furthest = static_cast<int>(face.outside.size()) - 1;
+    }
+}
+
+// Tetrahedron on the two points furthest apart among the axis extremes, the
+// point furthest from their line and the point furthest from that plane
+bool QuickHull::buildSimplex() {
+    int extreme[6] = {0, 0, 0, 0, 0, 0};
+    for (size_t i = 1; i < count_; ++i) {
+        const Vertex& p = points_[i];
+        const double c[3] = {p.x, p.y, p.z};
+        for (int k = 0; k < 3; ++k) {
+            const Vertex& lo = points_[extreme[2 * k]];
+            const Vertex& hi = points_[extreme[2 * k + 1]];
+            const double l[3] = {lo.x, lo.y, lo.z}, h[3] = {hi.x, hi.y, hi.z};
+            if (c[k] < l[k]) extreme[2 * k] = static_cast<int>(i);
+            if (c[k] > h[k]) extreme[2 * k + 1] = static_cast<int>(i);
+        }
+    }
+
+    int a = 0, b = 0;
+    double widest = 0;
+    for (int i = 0; i < 6; ++i) {
+        for (int j = i + 1; j < 6; ++j) {
+            double d = distance(points_[extreme[i]], points_[extreme[j]]);
+            if (d > widest) {
+                widest = d;
+                a = extreme[i];
+                b = extreme[j];
+            }
+        }
+    }
+    if (widest <= eps_) return false;
+
+    int c = -1;
+    double furthest = eps_;
+    for (size_t i = 0; i < count_; ++i) {
+        double d = length(spanCross(points_[a], points_[b], points_[i])) / widest;
+        if (d > furthest) {
+            furthest = d;
+            c = static_cast<int>(i);
+        }
+    }
+    if (c < 0) return false;
+
+    Vertex n = spanCross(points_[a], points_[b], points_[c]);
+    double len = length(n);
+    int d = -1;
+    double side = 0;
+    furthest = eps_;
+    for (size_t i = 0; i < count_; ++i) {
+        const Vertex& p = points_[i];
+        double s = (n.x * (p.x - points_[a].x) + n.y * (p.y - points_[a].y) + n.z * (p.z - points_[a].z)) / len;
+        if (fabs(s) > furthest) {
+            furthest = fabs(s);
+            side = s;
+            d = static_cast<int>(i);
+        }
+    }
+    if (d < 0) return false;
+    if (side > 0) swap(b, c);  // Now d is below abc
+
+    int faces[4] = {addFace(a, b, c), addFace(a, d, b), addFace(b, d, c), addFace(c, d, a)};
+    for (int f : faces) {
+        for (int i = 0; i < 3; ++i) {
+            int p = faces_[f].v[i], q = faces_[f].v[(i + 1) % 3];
+            for (int g : faces) {
+                for (int j = 0; j < 3; ++j) {
+                    if (faces_[g].v[j] == q && faces_[g].v[(j + 1) % 3] == p) faces_[f].neighbour[i] = g;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count_; ++i) {
+        int p = static_cast<int>(i);
+        if (p != a && p != b && p != c && p != d) assign(p, faces, 4);
+    }
+    for (int f : faces) {
+        if (!faces_[f].outside.empty()) pending_.push_back(f);
+    }
+    return true;
+}
+
+void QuickHull::dropFurthestPoint(int f) {
+    HullFace& face = faces_[f];
+    face.outside.erase(face.outside.begin() + face.furthest);
+    face.furthest = -1;
+    face.furthestDistance = 0;
+    for (size_t k = 0; k < face.outside.size(); ++k) {
+        double d = distanceAbove(face, points_[face.outside[k]]);
+        if (d > face.furthestDistance) {
+            face.furthestDistance = d;
+            face.furthest = static_cast<int>(k);
+        }
+    }
+    if (!face.outside.empty()) pending_.push_back(f);
+}
+
+void QuickHull::addFurthestPoint(int f) {
+    const int p = faces_[f].outside[faces_[f].furthest];
+    const Vertex& point = points_[p];
+
+    // Faces the point is above, grown outwards from f so they stay connected
+    ++stamp_;
+    visible_.assign(1, f);
+    faces_[f].visited = faces_[f].visible = stamp_;
+    for (size_t k = 0; k < visible_.size(); ++k) {
+        for (int i = 0; i < 3; ++i) {
+            HullFace& other = faces_[faces_[visible_[k]].neighbour[i]];
+            if (other.visited == stamp_) continue;
+            other.visited = stamp_;
+            if (distanceAbove(other, point) > eps_) {
+                other.visible = stamp_;
+                visible_.push_back(faces_[visible_[k]].neighbour[i]);
+            }
+        }
+    }
+
+    // Its boundary must be one loop through each vertex at most once
+    horizon_.clear();
+    bool simple = true;
+    for (int g : visible_) {
+        const HullFace& face = faces_[g];
+        for (int i = 0; i < 3; ++i) {
+            int across = face.neighbour[i];
+            if (faces_[across].visible == stamp_) continue;
+            HorizonEdge edge = {face.v[i], face.v[(i + 1) % 3], across};
+            if (slot_[edge.a] >= 0) simple = false;
+            slot_[edge.a] = static_cast<int>(horizon_.size());
+            horizon_.push_back(edge);
+        }
+    }
+    if (!simple) {
+        // Only a point within rounding of a face pinches the visible region;
+        // it is that close to the hull already, so it is left out
+        for (const HorizonEdge& edge : horizon_) slot_[edge.a] = -1;
+        dropFurthestPoint(f);
+        return;
+    }
+
+    orphans_.clear();
+    for (int g : visible_) {
+        HullFace& face = faces_[g];
+        for (int q : face.outside) {
+            if (q != p) orphans_.push_back(q);
+        }
+        face.outside.clear();
+        face.alive = false;
+        free_.push_back(g);
+    }
+
+    // A cone of new faces from the horizon to the point, stitched to each other through slot_
+    newFaces_.clear();
+    for (const HorizonEdge& edge : horizon_) {
+        int id = addFace(edge.a, edge.b, p);
+        faces_[id].neighbour[0] = edge.across;
+        HullFace& other = faces_[edge.across];
+        for (int j = 0; j < 3; ++j) {
+            if (other.v[j] == edge.b && other.v[(j + 1) % 3] == edge.a) other.neighbour[j] = id;
+        }
+        slot_[edge.a] = id;
+        newFaces_.push_back(id);
+    }
+    for (int id : newFaces_) {
+        int next = slot_[faces_[id].v[1]];
+        faces_[id].neighbour[1] = next;
+        faces_[next].neighbour[2] = id;
+    }
+    for (const HorizonEdge& edge : horizon_) slot_[edge.a] = -1;
+
+    for (int q : orphans_) assign(q, newFaces_.data(), newFaces_.size());
+    for (int id : newFaces_) {
+        if (!faces_[id].outside.empty()) pending_.push_back(id);
+    }
+}
+
+bool QuickHull::run(vector<int>& triangles) {
+    triangles.clear();
+    if (count_ < 4 || !buildSimplex()) return false;
+    while (!pending_.empty()) {
+        int f = pending_.back();
+        pending_.pop_back();
+        if (faces_[f].alive && !faces_[f].outside.empty()) addFurthestPoint(f);
+    }
+    for (const HullFace& face : faces_) {
+        if (!face.alive) continue;
+        triangles.insert(triangles.end(), face.v, face.v + 3);
+    }
+    return true;
+}
+
+ConvexHull convexHull(const Vertex* points, size_t count, unsigned numThreads) {
+    ConvexHull hull;
+    if (count < 4) return hull;
+
+    // Distances within a few units in the last place of the coordinates are rounding
+    Vertex reach = {0, 0, 0};
+    for (size_t i = 0; i < count; ++i) {
+        reach.x = max(reach.x, fabs(points[i].x));
+        reach.y = max(reach.y, fabs(points[i].y));
+        reach.z = max(reach.z, fabs(points[i].z));
+    }
+    const double eps = 1e-12 * (reach.x + reach.y + reach.z);
+
+    if (numThreads == 0) numThreads = thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 1;
+
+    const Vertex* input = points;
+    size_t inputCount = count;
+    vector<Vertex> merged;
+    if (numThreads > 1 && count >= HULL_PARALLEL_MIN * numThreads) {
+        vector<vector<Vertex> > kept(numThreads);
+        auto work = [&](unsigned t) {
+            size_t begin = count * t / numThreads, end = count * (t + 1) / numThreads;
+            vector<int> triangles;
+            QuickHull run(points + begin, end - begin, eps);
+            if (!run.run(triangles)) {
+                kept[t].assign(points + begin, points + end);
+                return;
+            }
+            vector<char> used(end - begin, 0);
+            for (int i : triangles) used[i] = 1;
+            for (size_t i = 0; i < used.size(); ++i) {
+                if (used[i]) kept[t].push_back(points[begin + i]);
+            }
+        };
+        vector<thread> workers;
+        for (unsigned t = 1; t < numThreads; ++t) workers.push_back(thread(work, t));
+        work(0);
+        for (auto& worker : workers) worker.join();
+
+        for (const vector<Vertex>& run : kept) merged.insert(merged.end(), run.begin(), run.end());
+        input = merged.data();
+        inputCount = merged.size();
+    }
+
+    vector<int> triangles;
+    QuickHull merge(input, inputCount, eps);
+    if (!merge.run(triangles)) return hull;
+
+    vector<int> index(inputCount, -1);
+    for (int& i : triangles) {
+        if (index[i] < 0) {
+            index[i] = static_cast<int>(hull.vertices.size());
+            hull.vertices.push_back(input[i]);
+        }
+        i = index[i];
+    }
+    hull.triangles.swap(triangles);
+
+    // Volume as tetrahedra from the first hull vertex, which keeps the terms small
+    const Vertex& apex = hull.vertices[0];
+    for (size_t t = 0; t < hull.triangles.size(); t += 3) {
+        const Vertex& a = hull.vertices[hull.triangles[t]];
+        const Vertex& b = hull.vertices[hull.triangles[t + 1]];
+        const Vertex& c = hull.vertices[hull.triangles[t + 2]];
+        Vertex n = spanCross(a, b, c);
+        double len = length(n);
+        hull.area += len / 2;
+        hull.volume += ((a.x - apex.x) * n.x + (a.y - apex.y) * n.y + (a.z - apex.z) * n.z) / 6;
+
+        HullPlane plane;
+        plane.normal = len > 0 ? Vertex{n.x / len, n.y / len, n.z / len} : n;
+        plane.offset = plane.normal.x * a.x + plane.normal.y * a.y + plane.normal.z * a.z;
+        hull.planes.push_back(plane);
+    }
+    return hull;
+}
+
+ConvexHull convexHull(const vector<Vertex>& points, unsigned numThreads) {
+    return convexHull(points.data(), points.size(), numThreads);
+}
+
+bool hullContains(const ConvexHull& hull, const Vertex& p, double tolerance) {
+    if (hull.empty()) return false;
+    for (const HullPlane& plane : hull.planes) {
+        if (plane.normal.x * p.x + plane.normal.y * p.y + plane.normal.z * p.z > plane.offset + tolerance) return false;
+    }
+    return true;
+}
+
+static void classifyShell(const Polyhedron& shell, int depth, unsigned numThreads, vector<ShellConvexity>& shells) {
+    ShellConvexity result;
+    result.depth = depth;
+    FaceMesh mesh = buildFaceMesh(shell, false);
+    VolumeIntegrals sums;
+    if (!mesh.vertices.empty()) accumulateMeshIntegrals(mesh, mesh.vertices[0], sums);
+    result.volume = fabs(sums.volume);
+    result.area = meshSurfaceArea(mesh);
+    result.hull = convexHull(shell.vertices, numThreads);
+
+    const ConvexHull& hull = result.hull;
+    result.convex = !hull.empty() && fabs(result.volume - hull.volume) <= CONVEXITY_TOLERANCE * hull.volume &&
+                    fabs(result.area - hull.area) <= CONVEXITY_TOLERANCE * hull.area;
+    shells.push_back(std::move(result));
+
+    for (const Polyhedron& hole : shell.sub_polyhedrons) {
+        classifyShell(hole, depth + 1, numThreads, shells);
+    }
+}
+
+vector<ShellConvexity> classifyShells(const Polyhedron& poly, unsigned numThreads) {
+    vector<ShellConvexity> shells;
+    classifyShell(poly, 0, numThreads, shells);
+    return shells;
+}
+
+bool isConvexSolid(const vector<ShellConvexity>& shells) {
+    return shells.size() == 1 && shells[0].convex;
+}
+
+// Ray parity over the shell's fan triangles, along the same direction as the collision tests
+static bool shellEncloses(const Polyhedron& shell, const Vertex& p) {
+    const Vector3d dir = parityRayDirection();
+    const Vector3d point(p.x, p.y, p.z);
+    int crossings = 0;
+    for (const Face& face : shell.faces) {
+        if (face.edges.size() < 3) continue;
+        const Vertex& first = face.edges[0].v1;
+        const Vector3d a(first.x, first.y, first.z);
+        for (size_t i = 1; i + 1 < face.edges.size(); ++i) {
+            const Vertex& second = face.edges[i].v1;
+            const Vertex& third = face.edges[i + 1].v1;
+            const Vector3d b(second.x, second.y, second.z), c(third.x, third.y, third.z);
+            double t;
+            if (rayHitsTriangle(point, dir, a, b, c, t) && t > 0) crossings++;
+        }
+    }
+    return crossings % 2 == 1;
+}
+
+static void countEnclosing(const Polyhedron& shell, const vector<ShellConvexity>& shells, size_t& next,
+                           const Vertex& p, int& count) {
+    const ShellConvexity& info = shells[next++];
+    if (info.convex ? hullContains(info.hull, p) : shellEncloses(shell, p)) ++count;
+    for (const Polyhedron& hole : shell.sub_polyhedrons) {
+        countEnclosing(hole, shells, next, p, count);
+    }
+}
+
+bool containsPoint(const Polyhedron& poly, const vector<ShellConvexity>& shells, const Vertex& p) {
+    size_t next = 0;
+    int count = 0;
+    countEnclosing(poly, shells, next, p, count);
+    return count % 2 == 1;
+}
@@ -0,0 +1,57 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include "input.h"
+
+// Supporting plane of one hull triangle; the hull lies where normal . x <= offset
+struct HullPlane {
+    Vertex normal;   // Unit length, pointing out of the hull
+    double offset;
+};
+
+struct ConvexHull {
+    vector<Vertex> vertices;   // Only the points on the hull
+    vector<int> triangles;     // Triples into vertices, wound counter-clockwise seen from outside
+    vector<HullPlane> planes;  // One per triangle
+    double volume;
+    double area;
+
+    ConvexHull() : volume(0), area(0) {}
+    bool empty() const { return triangles.empty(); }  // Fewer than four points off a common plane
+};
+
+// Quickhull (Barber, Dobkin and Huhdanpaa). Large inputs are cut into one
+// contiguous run per thread and each run's hull is found in parallel; only
+// the points on those hulls go into the final pass, since the hull of the
+// run hulls is the hull of everything. Points within rounding of a face are
+// treated as on it, so coplanar points never add slivers.
+ConvexHull convexHull(const Vertex* points, size_t count, unsigned numThreads = 0);
+ConvexHull convexHull(const vector<Vertex>& points, unsigned numThreads = 0);
+
+// Half-space test against every hull plane, with `tolerance` of slack
+bool hullContains(const ConvexHull& hull, const Vertex& p, double tolerance = 0);
+
+// One shell of a polyhedron next to its convex hull
+struct ShellConvexity {
+    int depth;       // 0 for the outer shell, 1 for its holes, and so on
+    bool convex;     // The shell is its own hull: same enclosed volume and same area
+    double volume;   // Enclosed by the shell alone, positive whichever way it is wound
+    double area;
+    ConvexHull hull;
+};
+
+// The hull of every shell, outer shell first, then holes depth-first. A
+// shell is convex when its volume and area both match its hull's to within
+// CONVEXITY_TOLERANCE (relative): an open, dented or self-overlapping shell
+// differs from its hull in one or the other.
+vector<ShellConvexity> classifyShells(const Polyhedron& poly, unsigned numThreads = 0);
+
+// The outer shell is convex and there are no holes, so the solid is convex
+bool isConvexSolid(const vector<ShellConvexity>& shells);
+
+// Whether p is inside the solid: an odd number of its shells enclose p.
+// Convex shells are tested against their hull's planes; the others by ray
+// parity over their fan triangles.
+bool containsPoint(const Polyhedron& poly, const vector<ShellConvexity>& shells, const Vertex& p);
+
+#endif
@@ -1,10 +1,13 @@
 #include "input.h"
+#include "transformations.h"
+#include "history.h"
+#include "reconstruction.h"
 
 using namespace std;
 using namespace Eigen;
 
 // Recursive function to get input for a polyhedron and its internal holes
-void getInput(Polyhedron& poly, const string& polyType) {
+void getInput(Polyhedron& poly, const Reconstructor& views, ReconstructionReport& report, const string& polyType) {
     int numVertices, numFaces;
     
     printf("Enter the number of vertices in the %s polyhedron: ", polyType.c_str());
@@ -14,35 +17,24 @@ void getInput(Polyhedron& poly, const string& polyType) {
     scanf("%d", &numFaces);
     poly.faces.resize(numFaces);
 
-    // Get 2D projections for each vertex of the current polyhedron
-    vector<double> xy(numVertices * 2);
-    vector<double> xz(numVertices * 2);
+    // Get the 2D projections of each vertex in every view
+    const size_t numViews = views.numViews();
+    vector<double> coords(numVertices * 2 * numViews);
 
     printf("Enter the 2D coordinates for the vertices in the %s polyhedron:\n", polyType.c_str());
     for (int i = 0; i < numVertices; ++i) {
-        printf("Vertex %d (xy): ", i + 1);
-        scanf("%lf %lf", &xy[i * 2], &xy[i * 2 + 1]);
-
-        printf("Vertex %d (xz): ", i + 1);
-        scanf("%lf %lf", &xz[i * 2], &xz[i * 2 + 1]);
+        for (size_t k = 0; k < numViews; ++k) {
+            double* uv = &coords[(i * numViews + k) * 2];
+            printf("Vertex %d (%s): ", i + 1, views.view(k).name.c_str());
+            scanf("%lf %lf", &uv[0], &uv[1]);
+        }
     }
 
-    // Reconstruct 3D vertices for this polyhedron
+    // Reconstruct 3D vertices for this polyhedron in one batch, with each vertex's disagreement between views
     poly.vertices.resize(numVertices);
-    MatrixXd A(4, 3);
-    A << 1, 0, 0,
-         0, 1, 0,
-         1, 0, 0,
-         0, 0, 1;
-
-    for (int i = 0; i < numVertices; ++i) {
-        VectorXd B(4);
-        B << xy[i * 2], xy[i * 2 + 1], xz[i * 2], xz[i * 2 + 1];
-        Vector3d X = A.colPivHouseholderQr().solve(B);
-        poly.vertices[i].x = X(0);
-        poly.vertices[i].y = X(1);
-        poly.vertices[i].z = X(2);
-    }
+    vector<double> residuals(numVertices);
+    views.solve(coords.data(), numVertices, poly.vertices.data(), residuals.data());
+    report.add(views, polyType, residuals.data(), residuals.size());
 
     // Get faces and edges for the current polyhedron
     for (int i = 0; i < numFaces; i++) {
@@ -59,6 +51,8 @@ void getInput(Polyhedron& poly, const string& polyType) {
             
             poly.faces[i].edges[j].v1 = poly.vertices[v1];
             poly.faces[i].edges[j].v2 = poly.vertices[v2];
+            poly.faces[i].edges[j].i1 = v1;
+            poly.faces[i].edges[j].i2 = v2;
             
             // Calculate edge length
             double dx = poly.faces[i].edges[j].v2.x - poly.faces[i].edges[j].v1.x;
@@ -77,7 +71,7 @@ void getInput(Polyhedron& poly, const string& polyType) {
     // Recursively get input and perform 3D reconstruction for each sub-polyhedron
     for (int i = 0; i < numSubPolyhedrons; ++i) {
         printf("\nEntering internal hole polyhedron %d of the %s polyhedron\n", i + 1, polyType.c_str());
-        getInput(poly.sub_polyhedrons[i], "internal hole " + to_string(i + 1));
+        getInput(poly.sub_polyhedrons[i], views, report, "internal hole " + to_string(i + 1));
     }
 }
 
@@ -107,4 +101,143 @@ void printPolyhedron(const Polyhedron& poly, const string& polyType, int level)
         printf("\n%*sInternal Hole Polyhedron %zu:\n", level * 2, "", i + 1);
         printPolyhedron(poly.sub_polyhedrons[i], "internal hole " + to_string(i + 1), level + 1);
     }
-}
\ No newline at end of file
+}
+
+bool getValidatedDouble(double &value, const std::string &prompt) {
+    std::cout << prompt;
+    while (!(std::cin >> value)) {
+        std::cout << "Invalid input. Please enter a number.\n" << prompt;
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return true;
+}
+
+bool getValidatedFloat(float &value, const std::string &prompt) {
+    std::cout << prompt;
+    while (!(std::cin >> value)) {
+        std::cout << "Invalid input. Please enter a number.\n" << prompt;
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return true;
+}
+
+bool getValidatedChoice(int &choice, int min, int max, const std::string &prompt) {
+    std::cout << prompt;
+    while (!(std::cin >> choice) || choice < min || choice > max) {
+        std::cout << "Invalid input. Please enter a number between " << min << " and " << max << ".\n" << prompt;
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return true;
+}
+
+bool promptTransformOp(int choice, TransformOp &op) {
+    switch (choice) {
+        case 1: { // Rotate
+            double angle;
+            float A, B, C, D;
+            getValidatedDouble(angle, "Enter the rotation angle (in degrees): ");
+            
+            std::cout << "Enter the coefficients of the plane equation (Ax + By + Cz = D):\n";
+            getValidatedFloat(A, "A (normal x-component): ");
+            getValidatedFloat(B, "B (normal y-component): ");
+            getValidatedFloat(C, "C (normal z-component): ");
+            getValidatedFloat(D, "D (distance from origin): ");
+
+            if (A == 0 && B == 0 && C == 0) {
+                std::cout << "Error: The normal vector cannot be zero. Rotation canceled.\n";
+                return false;
+            }
+
+            op = {TRANSFORM_ROTATE, {angle, A, B, C}};
+            return true;
+        }
+        case 2: { // Translate
+            double dx, dy, dz;
+            getValidatedDouble(dx, "Enter translation value dx: ");
+            getValidatedDouble(dy, "Enter translation value dy: ");
+            getValidatedDouble(dz, "Enter translation value dz: ");
+
+            op = {TRANSFORM_TRANSLATE, {dx, dy, dz, 0}};
+            return true;
+        }
+        case 3: { // Scale
+            double sx, sy, sz;
+            getValidatedDouble(sx, "Enter scaling factor sx: ");
+            getValidatedDouble(sy, "Enter scaling factor sy: ");
+            getValidatedDouble(sz, "Enter scaling factor sz: ");
+
+            op = {TRANSFORM_SCALE, {sx, sy, sz, 0}};
+            return true;
+        }
+        default: { // Reflect
+            float A, B, C, D;
+            std::cout << "Enter the coefficients of the plane equation (Ax + By + Cz = D):\n";
+            getValidatedFloat(A, "A (normal x-component): ");
+            getValidatedFloat(B, "B (normal y-component): ");
+            getValidatedFloat(C, "C (normal z-component): ");
+            getValidatedFloat(D, "D (distance from origin): ");
+
+            if (A == 0 && B == 0 && C == 0) {
+                std::cout << "Error: The normal vector cannot be zero. Reflection canceled.\n";
+                return false;
+            }
+
+            op = {TRANSFORM_REFLECT, {A, B, C, D}};
+            return true;
+        }
+    }
+}
+
+bool transform_polyhedron(TransformHistory &history) {
+    int choice;
+    getValidatedChoice(choice, 1, 7, "Choose transformation:\n1. Rotate around a plane\n2. Translate\n3. Scale\n4. Reflect across a plane\n5. Undo\n6. Redo\n7. History\n");
+
+    static const char* const labels[] = {"Rotated Polyhedron", "Translated Polyhedron", "Scaled Polyhedron", "Reflected Polyhedron"};
+    TransformOp op;
+    const char* label = "";
+    switch (choice) {
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+            if (!promptTransformOp(choice, op)) {
+                return false;
+            }
+            label = labels[choice - 1];
+            break;
+        case 5: // Undo
+            if (!history.undo()) {
+                std::cout << "Nothing to undo.\n";
+                return false;
+            }
+            std::cout << "Undone; now at step " << history.step() << ".\n";
+            return true;
+        case 6: // Redo
+            if (!history.redo()) {
+                std::cout << "Nothing to redo.\n";
+                return false;
+            }
+            std::cout << "Redone; now at step " << history.step() << ".\n";
+            return true;
+        default: { // History
+            printTransformHistory(history);
+            int step;
+            int last = static_cast<int>(history.operations().size());
+            getValidatedChoice(step, -1, last, "Enter a step to return to (-1 to go back): ");
+            if (step < 0 || static_cast<size_t>(step) == history.step()) {
+                return false;
+            }
+            history.jumpTo(step);
+            std::cout << "Now at step " << step << ".\n";
+            return true;
+        }
+    }
+
+    history.apply(op);
+    std::cout << "\n" << label << ":\n";
+    printPolyhedron(*history.current());
+    return true;
+}
@@ -33,6 +33,7 @@ struct Vertex {
 struct Edge {
     Vertex v1, v2;
     double length;
+    int i1, i2; // Indices of v1 and v2 in the owning Polyhedron's vertices
 };
 
 struct Face {
@@ -67,8 +68,17 @@ struct InertiaTensor {
     }
 };
 
-void getInput(Polyhedron& poly, const string& polyType = "outer");
+class Reconstructor;
+struct ReconstructionReport;
+
+// Vertices are typed as their 2D coordinates in each of the views, in order
+void getInput(Polyhedron& poly, const Reconstructor& views, ReconstructionReport& report, const string& polyType = "outer");
 
 void printPolyhedron(const Polyhedron& poly, const string& polyType = "outer", int level = 1);
 
+// Prompt until the user types a valid value
+bool getValidatedDouble(double &value, const std::string &prompt);
+bool getValidatedFloat(float &value, const std::string &prompt);
+bool getValidatedChoice(int &choice, int min, int max, const std::string &prompt);
+
 #endif 
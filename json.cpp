@@ -0,0 +1,182 @@
+#include "json.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+const JsonValue* JsonValue::get(const string& key) const {
+    if (type != OBJECT) return nullptr;
+    for (const auto& member : members) {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+// Recursive-descent parser over a string; pos always points at the next unread character
+struct JsonParser {
+    const string& in;
+    size_t pos;
+    string error;
+
+    explicit JsonParser(const string& input) : in(input), pos(0) {}
+
+    void skipSpace() {
+        while (pos < in.size() && (in[pos] == ' ' || in[pos] == '\t' || in[pos] == '\r' || in[pos] == '\n')) pos++;
+    }
+
+    bool fail(const string& message) {
+        if (error.empty()) error = message + " at offset " + to_string(pos);
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t n = strlen(word);
+        if (in.compare(pos, n, word) != 0) return fail("invalid literal");
+        pos += n;
+        return true;
+    }
+
+    bool parseString(string& out) {
+        pos++; // Opening quote
+        while (pos < in.size() && in[pos] != '"') {
+            char c = in[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= in.size()) break;
+            char e = in[pos++];
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (pos + 4 > in.size()) return fail("bad unicode escape");
+                    unsigned code = strtoul(in.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    // Basic multilingual plane only, encoded as UTF-8
+                    if (code < 0x80) {
+                        out += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        out += static_cast<char>(0xC0 | (code >> 6));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        out += static_cast<char>(0xE0 | (code >> 12));
+                        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += e; break; // \" \\ \/
+            }
+        }
+        if (pos >= in.size()) return fail("unterminated string");
+        pos++; // Closing quote
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > 64) return fail("nesting too deep");
+        skipSpace();
+        if (pos >= in.size()) return fail("unexpected end of input");
+
+        char c = in[pos];
+        if (c == '{') {
+            value.type = JsonValue::OBJECT;
+            pos++;
+            skipSpace();
+            if (pos < in.size() && in[pos] == '}') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                skipSpace();
+                if (pos >= in.size() || in[pos] != '"') return fail("expected key");
+                pair<string, JsonValue> member;
+                if (!parseString(member.first)) return false;
+                skipSpace();
+                if (pos >= in.size() || in[pos] != ':') return fail("expected ':'");
+                pos++;
+                if (!parseValue(member.second, depth + 1)) return false;
+                value.members.push_back(std::move(member));
+                skipSpace();
+                if (pos < in.size() && in[pos] == ',') { pos++; continue; }
+                if (pos < in.size() && in[pos] == '}') { pos++; return true; }
+                return fail("expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            value.type = JsonValue::ARRAY;
+            pos++;
+            skipSpace();
+            if (pos < in.size() && in[pos] == ']') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                value.items.push_back(JsonValue());
+                if (!parseValue(value.items.back(), depth + 1)) return false;
+                skipSpace();
+                if (pos < in.size() && in[pos] == ',') { pos++; continue; }
+                if (pos < in.size() && in[pos] == ']') { pos++; return true; }
+                return fail("expected ',' or ']'");
+            }
+        }
+        if (c == '"') {
+            value.type = JsonValue::STRING;
+            return parseString(value.text);
+        }
+        if (c == 't') { value.type = JsonValue::BOOLEAN; value.boolean = true; return literal("true"); }
+        if (c == 'f') { value.type = JsonValue::BOOLEAN; value.boolean = false; return literal("false"); }
+        if (c == 'n') { value.type = JsonValue::NUL; return literal("null"); }
+
+        const char* start = in.c_str() + pos;
+        char* end = nullptr;
+        value.type = JsonValue::NUMBER;
+        value.number = strtod(start, &end);
+        if (end == start) return fail("unexpected character");
+        pos += end - start;
+        return true;
+    }
+};
+
+bool parseJson(const string& input, JsonValue& value, string& error) {
+    JsonParser parser(input);
+    value = JsonValue();
+    if (!parser.parseValue(value, 0)) {
+        error = parser.error;
+        return false;
+    }
+    parser.skipSpace();
+    if (parser.pos != input.size()) {
+        error = "trailing characters at offset " + to_string(parser.pos);
+        return false;
+    }
+    return true;
+}
+
+string jsonString(const string& text) {
+    string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
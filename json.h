@@ -0,0 +1,34 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON value for the service protocol (one request per line)
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type;
+    bool boolean;
+    double number;
+    std::string text;
+    std::vector<JsonValue> items;                             // ARRAY
+    std::vector<std::pair<std::string, JsonValue> > members;  // OBJECT, in input order
+
+    JsonValue() : type(NUL), boolean(false), number(0) {}
+
+    // Member lookup; returns nullptr if this is not an object or the key is missing
+    const JsonValue* get(const std::string& key) const;
+    bool isNumber() const { return type == NUMBER; }
+    bool isString() const { return type == STRING; }
+    bool isArray() const { return type == ARRAY; }
+    bool isObject() const { return type == OBJECT; }
+};
+
+bool parseJson(const std::string& input, JsonValue& value, std::string& error);
+
+// Quotes and escapes a string for output
+std::string jsonString(const std::string& text);
+
+#endif
@@ -0,0 +1,400 @@
+#include "lod.h"
+#include "facemesh.h"
+#include "scheduler.h"
+
+#include <cstdint>
+#include <queue>
+#include <unordered_set>
+
+using namespace std;
+using namespace Eigen;
+
+// Sum of weighted squared distances to planes: the symmetric 4x4 matrix of
+// the plane outer products, upper triangle stored row by row
+struct Quadric {
+    double q[10];
+
+    Quadric() { fill(q, q + 10, 0.0); }
+
+    void addPlane(const Vector3d& n, double d, double weight) {
+        double a = n.x(), b = n.y(), c = n.z();
+        q[0] += weight * a * a; q[1] += weight * a * b; q[2] += weight * a * c; q[3] += weight * a * d;
+        q[4] += weight * b * b; q[5] += weight * b * c; q[6] += weight * b * d;
+        q[7] += weight * c * c; q[8] += weight * c * d;
+        q[9] += weight * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        for (int k = 0; k < 10; ++k) q[k] += other.q[k];
+        return *this;
+    }
+
+    double weight() const { return q[0] + q[4] + q[7]; }  // Total weight of the planes, as |n| = 1
+
+    double evaluate(const Vector3d& p) const {
+        double x = p.x(), y = p.y(), z = p.z();
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+               q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    // The point of least error, unless the planes leave it undetermined
+    bool minimiser(Vector3d& p) const {
+        Matrix3d A;
+        A << q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7];
+        double scale = A.trace();
+        if (fabs(A.determinant()) <= 1e-10 * scale * scale * scale) return false;
+        p = A.inverse() * Vector3d(-q[3], -q[6], -q[8]);
+        return true;
+    }
+};
+
+struct Collapse {
+    double cost;
+    double distance;        // Root mean square distance of target from the merged planes
+    int a, b;               // b is merged into a
+    unsigned stampA, stampB;
+    Vector3d target;
+
+    bool operator<(const Collapse& other) const { return cost > other.cost; }  // Cheapest on top
+};
+
+// Open edges get a plane through them, perpendicular to their face, this many
+// times heavier than a face plane
+const double BOUNDARY_WEIGHT = 1e3;
+
+class Simplifier {
+public:
+    explicit Simplifier(const Polyhedron& shell);
+
+    size_t liveTriangles() const { return live_; }
+    // Collapses the cheapest edges until at most `target` triangles are left;
+    // false once no allowed collapse remains
+    bool reduceTo(size_t target, TaskState* state);
+    LodLevel level() const;
+
+private:
+    void pushEdge(int a, int b);
+    bool collapseAllowed(int a, int b, const Vector3d& target);
+    void collapse(int a, int b, const Vector3d& target);
+    void liveNeighbours(int v, vector<int>& out) const;
+
+    vector<Vector3d> points_;
+    vector<Quadric> quadrics_;
+    vector<int> triangles_;                // Three per triangle; [3t] is -1 once it is gone
+    vector<vector<int> > vertexTriangles_; // May still list triangles that are gone
+    vector<unsigned> stamp_;               // Bumped whenever a vertex moves or merges
+    vector<bool> removed_;
+    priority_queue<Collapse> queue_;
+    size_t live_;
+    double worstDistance_;
+    vector<int> scratchA_, scratchB_;
+};
+
+Simplifier::Simplifier(const Polyhedron& shell) : live_(0), worstDistance_(0) {
+    size_t n = shell.vertices.size();
+    points_.reserve(n);
+    for (const Vertex& v : shell.vertices) points_.push_back(Vector3d(v.x, v.y, v.z));
+    quadrics_.resize(n);
+    vertexTriangles_.resize(n);
+    stamp_.assign(n, 0);
+    removed_.assign(n, false);
+
+    // Fan-triangulate each face; the face's own plane goes into its vertices' quadrics once
+    vector<int> loop;
+    for (const Face& face : shell.faces) {
+        loop.clear();
+        for (const Edge& edge : face.edges) loop.push_back(edge.i1);
+        if (loop.size() < 3) continue;
+        Vertex area = faceVectorArea<0>(shell.vertices.data(), loop.data(), static_cast<int>(loop.size()));
+        Vector3d normal(area.x, area.y, area.z);
+        if (normal.norm() > 0) {
+            normal.normalize();
+            double d = -normal.dot(points_[loop[0]]);
+            for (int v : loop) quadrics_[v].addPlane(normal, d, 1.0);
+        }
+        for (size_t i = 1; i + 1 < loop.size(); ++i) {
+            int t = static_cast<int>(triangles_.size() / 3);
+            int corners[3] = {loop[0], loop[i], loop[i + 1]};
+            for (int v : corners) {
+                triangles_.push_back(v);
+                vertexTriangles_[v].push_back(t);
+            }
+            ++live_;
+        }
+    }
+
+    // Directed triangle edges without a reversed partner lie on a border
+    unordered_set<uint64_t> directed;
+    directed.reserve(triangles_.size());
+    for (size_t t = 0; t < triangles_.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = triangles_[t + k], b = triangles_[t + (k + 1) % 3];
+            directed.insert(static_cast<uint64_t>(a) << 32 | b);
+        }
+    }
+    for (size_t t = 0; t < triangles_.size(); t += 3) {
+        const Vector3d& p0 = points_[triangles_[t]];
+        Vector3d faceNormal = (points_[triangles_[t + 1]] - p0).cross(points_[triangles_[t + 2]] - p0);
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = triangles_[t + k], b = triangles_[t + (k + 1) % 3];
+            if (a == b || directed.count(static_cast<uint64_t>(b) << 32 | a)) continue;
+            Vector3d side = faceNormal.cross(points_[b] - points_[a]);
+            if (side.norm() == 0) continue;
+            side.normalize();
+            double d = -side.dot(points_[a]);
+            quadrics_[a].addPlane(side, d, BOUNDARY_WEIGHT);
+            quadrics_[b].addPlane(side, d, BOUNDARY_WEIGHT);
+        }
+    }
+
+    for (size_t t = 0; t < triangles_.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            int a = triangles_[t + k], b = triangles_[t + (k + 1) % 3];
+            if (a < b) pushEdge(a, b);
+        }
+    }
+}
+
+void Simplifier::pushEdge(int a, int b) {
+    if (a == b) return;
+    Quadric sum = quadrics_[a];
+    sum += quadrics_[b];
+
+    // The quadric's own minimiser unless it is undetermined or strays far
+    // from the edge (nearly parallel planes); then the best of the end points
+    // and the midpoint
+    Collapse c;
+    Vector3d mid = (points_[a] + points_[b]) / 2.0;
+    double reach = 2.0 * (points_[b] - points_[a]).norm();
+    if (sum.minimiser(c.target) && (c.target - mid).norm() <= reach) {
+        c.cost = sum.evaluate(c.target);
+    } else {
+        const Vector3d options[3] = {points_[a], points_[b], mid};
+        c.cost = numeric_limits<double>::max();
+        for (const Vector3d& p : options) {
+            double cost = sum.evaluate(p);
+            if (cost < c.cost) {
+                c.cost = cost;
+                c.target = p;
+            }
+        }
+    }
+    c.cost = max(0.0, c.cost);
+    c.distance = sum.weight() > 0 ? sqrt(c.cost / sum.weight()) : 0;
+    c.a = a;
+    c.b = b;
+    c.stampA = stamp_[a];
+    c.stampB = stamp_[b];
+    queue_.push(c);
+}
+
+void Simplifier::liveNeighbours(int v, vector<int>& out) const {
+    out.clear();
+    for (int t : vertexTriangles_[v]) {
+        if (triangles_[3 * t] < 0) continue;
+        for (int k = 0; k < 3; ++k) {
+            if (triangles_[3 * t + k] != v) out.push_back(triangles_[3 * t + k]);
+        }
+    }
+    sort(out.begin(), out.end());
+    out.erase(unique(out.begin(), out.end()), out.end());
+}
+
+bool Simplifier::collapseAllowed(int a, int b, const Vector3d& target) {
+    // Link condition: the end points may only share the vertices opposite the
+    // edge, otherwise the collapse pinches the surface into a non-manifold
+    liveNeighbours(a, scratchA_);
+    liveNeighbours(b, scratchB_);
+    size_t shared = 0;
+    for (int v : scratchA_) {
+        if (binary_search(scratchB_.begin(), scratchB_.end(), v)) ++shared;
+    }
+    size_t edgeTriangles = 0;
+    for (int t : vertexTriangles_[a]) {
+        if (triangles_[3 * t] < 0) continue;
+        const int* tri = &triangles_[3 * t];
+        if (tri[0] == b || tri[1] == b || tri[2] == b) ++edgeTriangles;
+    }
+    if (edgeTriangles == 0 || shared != edgeTriangles) return false;
+
+    // No surviving triangle may turn over or collapse to a sliver
+    for (int side = 0; side < 2; ++side) {
+        int v = side == 0 ? a : b, other = side == 0 ? b : a;
+        for (int t : vertexTriangles_[v]) {
+            if (triangles_[3 * t] < 0) continue;
+            const int* tri = &triangles_[3 * t];
+            if (tri[0] == other || tri[1] == other || tri[2] == other) continue;
+            Vector3d before[3], after[3];
+            for (int k = 0; k < 3; ++k) {
+                before[k] = points_[tri[k]];
+                after[k] = tri[k] == v ? target : before[k];
+            }
+            Vector3d n0 = (before[1] - before[0]).cross(before[2] - before[0]);
+            Vector3d n1 = (after[1] - after[0]).cross(after[2] - after[0]);
+            if (n0.dot(n1) <= 0.05 * n0.norm() * n1.norm() || n1.squaredNorm() <= 1e-12 * n0.squaredNorm()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Simplifier::collapse(int a, int b, const Vector3d& target) {
+    points_[a] = target;
+    quadrics_[a] += quadrics_[b];
+    for (int t : vertexTriangles_[b]) {
+        int* tri = &triangles_[3 * t];
+        if (tri[0] < 0) continue;
+        if (tri[0] == a || tri[1] == a || tri[2] == a) {
+            tri[0] = -1;
+            --live_;
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            if (tri[k] == b) tri[k] = a;
+        }
+        vertexTriangles_[a].push_back(t);
+    }
+    vector<int>& own = vertexTriangles_[a];
+    own.erase(remove_if(own.begin(), own.end(), [this](int t) { return triangles_[3 * t] < 0; }), own.end());
+    vector<int>().swap(vertexTriangles_[b]);
+    removed_[b] = true;
+    stamp_[a]++;
+    stamp_[b]++;
+
+    liveNeighbours(a, scratchA_);
+    for (int v : scratchA_) pushEdge(a, v);
+}
+
+bool Simplifier::reduceTo(size_t target, TaskState* state) {
+    size_t steps = 0;
+    while (live_ > target) {
+        if (queue_.empty()) return false;
+        Collapse c = queue_.top();
+        queue_.pop();
+        if (removed_[c.a] || removed_[c.b] || stamp_[c.a] != c.stampA || stamp_[c.b] != c.stampB) continue;
+        if (!collapseAllowed(c.a, c.b, c.target)) continue;
+        collapse(c.a, c.b, c.target);
+        worstDistance_ = max(worstDistance_, c.distance);
+        if (state && (++steps & 4095) == 0) state->checkCancelled();
+    }
+    return true;
+}
+
+LodLevel Simplifier::level() const {
+    LodLevel result;
+    vector<int> remap(points_.size(), -1);
+    unordered_set<uint64_t> seen;
+    for (size_t t = 0; t < triangles_.size(); t += 3) {
+        if (triangles_[t] < 0) continue;
+        for (int k = 0; k < 3; ++k) {
+            int v = triangles_[t + k];
+            if (remap[v] < 0) {
+                remap[v] = static_cast<int>(result.vertices.size());
+                result.vertices.push_back({points_[v].x(), points_[v].y(), points_[v].z()});
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = remap[triangles_[t + k]], b = remap[triangles_[t + (k + 1) % 3]];
+            if (!seen.insert(static_cast<uint64_t>(min(a, b)) << 32 | max(a, b)).second) continue;
+            result.edges.push_back(a);
+            result.edges.push_back(b);
+        }
+    }
+    result.faces = live_;
+    result.error = worstDistance_;
+    return result;
+}
+
+// The shell as loaded: its own polygon edges, each once
+static LodLevel fullLevel(const Polyhedron& shell) {
+    LodLevel result;
+    result.vertices = shell.vertices;
+    unordered_set<uint64_t> seen;
+    for (const Face& face : shell.faces) {
+        for (const Edge& edge : face.edges) {
+            uint32_t a = edge.i1, b = edge.i2;
+            if (a == b || !seen.insert(static_cast<uint64_t>(min(a, b)) << 32 | max(a, b)).second) continue;
+            result.edges.push_back(edge.i1);
+            result.edges.push_back(edge.i2);
+        }
+    }
+    result.faces = shell.faces.size();
+    result.error = 0;
+    return result;
+}
+
+static LodChain buildChain(const Polyhedron& shell, int depth, TaskState* state) {
+    LodChain chain;
+    chain.depth = depth;
+    chain.levels.push_back(fullLevel(shell));
+
+    Simplifier simplifier(shell);
+    size_t previous = simplifier.liveTriangles();
+    while (previous / 4 >= LOD_MIN_TRIANGLES) {
+        bool reached = simplifier.reduceTo(previous / 4, state);
+        // Stop when the collapses that are still allowed barely help
+        if (!reached && simplifier.liveTriangles() > previous * 3 / 4) break;
+        chain.levels.push_back(simplifier.level());
+        previous = simplifier.liveTriangles();
+        if (!reached) break;
+    }
+    return chain;
+}
+
+LodChain buildLodChain(const Polyhedron& shell, int depth) {
+    return buildChain(shell, depth, nullptr);
+}
+
+static size_t countFaces(const Polyhedron& poly) {
+    size_t total = poly.faces.size();
+    for (const Polyhedron& hole : poly.sub_polyhedrons) total += countFaces(hole);
+    return total;
+}
+
+static void appendChains(const Polyhedron& poly, int depth, TaskState* state, size_t totalFaces, size_t& doneFaces,
+                         PolyhedronLod& lod) {
+    if (state) state->checkCancelled();
+    lod.shells.push_back(buildChain(poly, depth, state));
+    lod.fullEdges += lod.shells.back().levels[0].edges.size() / 2;
+    doneFaces += poly.faces.size();
+    if (state && totalFaces > 0) state->setProgress(static_cast<double>(doneFaces) / totalFaces);
+    for (const Polyhedron& hole : poly.sub_polyhedrons) {
+        appendChains(hole, depth + 1, state, totalFaces, doneFaces, lod);
+    }
+}
+
+PolyhedronLod buildPolyhedronLod(const Polyhedron& poly, TaskState* state) {
+    PolyhedronLod lod;
+    lod.fullEdges = 0;
+    size_t doneFaces = 0;
+    appendChains(poly, 0, state, countFaces(poly), doneFaces, lod);
+    return lod;
+}
+
+static void appendFullLevels(const Polyhedron& poly, int depth, PolyhedronLod& lod) {
+    LodChain chain;
+    chain.depth = depth;
+    chain.levels.push_back(fullLevel(poly));
+    lod.fullEdges += chain.levels[0].edges.size() / 2;
+    lod.shells.push_back(std::move(chain));
+    for (const Polyhedron& hole : poly.sub_polyhedrons) {
+        appendFullLevels(hole, depth + 1, lod);
+    }
+}
+
+PolyhedronLod fullDetailLod(const Polyhedron& poly) {
+    PolyhedronLod lod;
+    lod.fullEdges = 0;
+    appendFullLevels(poly, 0, lod);
+    return lod;
+}
+
+int pickLodLevel(const LodChain& chain, double pixelsPerUnit, double pixelTolerance, size_t edgeBudget) {
+    int last = static_cast<int>(chain.levels.size()) - 1;
+    int level = 0;
+    while (level < last && chain.levels[level + 1].error * pixelsPerUnit <= pixelTolerance) ++level;
+    while (level < last && chain.levels[level].edges.size() / 2 > edgeBudget) ++level;
+    return level;
+}
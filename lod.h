@@ -0,0 +1,46 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include "input.h"
+
+struct TaskState;
+
+// One level of detail of a shell, ready to draw as a wireframe
+struct LodLevel {
+    vector<Vertex> vertices;
+    vector<int> edges;   // Pairs of indices into vertices, each undirected edge once
+    size_t faces;        // Triangles left, or the shell's own faces at level 0
+    double error;        // Rough distance from the original surface, in model units
+};
+
+// Successively coarser versions of one shell. levels[0] is the shell itself
+// with its own polygon edges; each further level keeps about a quarter of the
+// previous level's triangles, down to LOD_MIN_TRIANGLES.
+struct LodChain {
+    vector<LodLevel> levels;
+    int depth;           // 0 for the outer shell, 1 for its holes, and so on
+};
+
+struct PolyhedronLod {
+    vector<LodChain> shells;  // Outer shell first, then holes depth-first
+    size_t fullEdges;         // Edges over all shells at level 0
+};
+
+const size_t LOD_MIN_TRIANGLES = 256;
+
+// Quadric error metric edge collapse (Garland and Heckbert) on the fan
+// triangulation of the shell's faces. Collapses that would flip a triangle or
+// pinch the surface (link condition) are refused, and open edges carry a
+// heavy perpendicular quadric so borders stay put. Holes are not included.
+LodChain buildLodChain(const Polyhedron& shell, int depth = 0);
+// One chain per shell, holes included; reports progress per shell
+PolyhedronLod buildPolyhedronLod(const Polyhedron& poly, TaskState* state = nullptr);
+// Only level 0 of every shell: the same layout for parts too small to simplify
+PolyhedronLod fullDetailLod(const Polyhedron& poly);
+
+// The coarsest level whose error stays within `pixelTolerance` on screen at
+// `pixelsPerUnit`, made coarser still while it has more than `edgeBudget`
+// edges (but never past the last level)
+int pickLodLevel(const LodChain& chain, double pixelsPerUnit, double pixelTolerance, size_t edgeBudget);
+
+#endif
@@ -4,43 +4,159 @@
 #include "projections.h"
 #include "constants.h"
 #include "transformations.h"
+#include "stream.h"
+#include "weld.h"
+#include "halfedge.h"
+#include "scheduler.h"
+#include "viewer.h"
+#include "cache.h"
+#include "service.h"
+#include "slicing.h"
+#include "scene.h"
+#include "collision.h"
+#include "lod.h"
+#include "archive.h"
+#include "memory.h"
+#include "history.h"
+#include "reconstruction.h"
+#include "animation.h"
+#include "hull.h"
+#include "deviation.h"
+#include "facemesh.h"
+
+#include <sstream>
 
 using namespace std;
 using namespace Eigen;
 
-int main() {
-    Polyhedron poly;
+// Helper function to start a background computation on the latest committed geometry
+static void submitAnalysis(TaskScheduler& scheduler, GeometryStore& store, vector<Task<string> >& jobs,
+                           const string& name, function<string(const Polyhedron&, TaskState&)> compute) {
+    shared_ptr<const Polyhedron> snapshot = store.snapshot();
+    jobs.push_back(scheduler.submit<string>(name, [snapshot, compute](TaskState& state) {
+        state.checkCancelled();
+        return compute(*snapshot, state);
+    }));
+    cout << "Started \"" << name << "\" in the background (task " << jobs.size() << ").\n";
+}
+
+// Print and forget every finished background task
+static void reportFinishedTasks(vector<Task<string> >& jobs) {
+    for (size_t i = 0; i < jobs.size();) {
+        if (!jobs[i].ready()) {
+            ++i;
+            continue;
+        }
+        try {
+            string result = jobs[i].get();
+            cout << "\n[" << jobs[i].state->name << "] " << result;
+        } catch (const TaskCancelled&) {
+            cout << "\n[" << jobs[i].state->name << "] cancelled\n";
+        } catch (const exception& e) {
+            cout << "\n[" << jobs[i].state->name << "] failed: " << e.what() << "\n";
+        }
+        jobs.erase(jobs.begin() + i);
+    }
+}
+
+static void showTaskStatus(vector<Task<string> >& jobs) {
+    if (jobs.empty()) {
+        cout << "No background tasks are running.\n";
+        return;
+    }
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        printf("%zu. %s: %.0f%%\n", i + 1, jobs[i].state->name.c_str(), jobs[i].state->progress() * 100.0);
+    }
+    int choice;
+    getValidatedChoice(choice, 0, static_cast<int>(jobs.size()), "Enter a task number to cancel (0 to go back): ");
+    if (choice > 0) {
+        jobs[choice - 1].cancel();
+    }
+}
+
+// Transformations are affine, so the loaded part's levels of detail carry
+// over to every later version under one composed map instead of a rebuild.
+// Does nothing until the levels task has finished or while the store already has levels.
+static void commitTransformedLod(GeometryStore& store, TransformHistory& history, const Task<string>& lodJob,
+                                 const shared_ptr<shared_ptr<const PolyhedronLod> >& baseLod) {
+    if (!lodJob.state || !lodJob.ready() || store.lodSnapshot()) return;
+    shared_ptr<const PolyhedronLod> base = *baseLod;  // Null if the task was cancelled or failed
+    if (!base) return;
+    shared_ptr<const Polyhedron> current = history.current();
+    if (store.snapshot() != current) return;
+
+    shared_ptr<PolyhedronLod> moved = make_shared<PolyhedronLod>(*base);
+    for (LodChain& chain : moved->shells) {
+        for (LodLevel& level : chain.levels) {
+            double stretch = applyTransformOps(history.operations(), history.step(), level.vertices.data(),
+                                               level.vertices.size());
+            level.error *= stretch;
+        }
+    }
+    store.commitLod(current, moved);
+}
+
+static void runMenu(GeometryStore& store, TaskScheduler& scheduler, UiHost& ui, ResultCache* cache,
+                    const Vertex& origin, double density) {
+    vector<Task<string> > jobs;
     int task;
-    Vertex origin = {0, 0, 0};
-    double density = 1.0;
 
-    getInput(poly, "outer");
+    shared_ptr<const Polyhedron> loaded = store.snapshot();
+    TransformHistory history(loaded);
 
-    printPolyhedron(poly, "outer", 1);
+    // The last reference part stays loaded, so the engine keeps its surface
+    // cached while revisions of the working part are compared against it
+    shared_ptr<DeviationEngine> deviationEngine = make_shared<DeviationEngine>();
+    shared_ptr<const Polyhedron> reference;
+    string referencePath;
+    int referenceIndex = 0;
 
-    // Validate the input
-    bool isValid = validateInput(poly);
-    
-    if (isValid) {
-        cout << "The input and reconstruction are valid.\n";
-    } else {
-        cout << "The input or reconstruction is invalid.\n";
-        return 1;  // Exit if the input is invalid
+    // Simplified levels keep the viewer interactive on large meshes; until
+    // they are ready it draws the full polyhedron. baseLod is written by the
+    // task before it finishes, so it is readable once lodJob is ready.
+    shared_ptr<shared_ptr<const PolyhedronLod> > baseLod = make_shared<shared_ptr<const PolyhedronLod> >();
+    Task<string> lodJob;
+    if (loaded->faces.size() >= 4 * LOD_MIN_TRIANGLES) {
+        lodJob = scheduler.submit<string>("Level of Detail", [loaded, baseLod, &store](TaskState& state) {
+            shared_ptr<const PolyhedronLod> lod = make_shared<const PolyhedronLod>(buildPolyhedronLod(*loaded, &state));
+            *baseLod = lod;
+            store.commitLod(loaded, lod);
+            const LodChain& outer = lod->shells[0];
+            ostringstream out;
+            out << "Viewer levels of detail ready: " << outer.levels.size() << " for the outer shell, down to "
+                << outer.levels.back().faces << " triangles\n";
+            return out.str();
+        });
+        jobs.push_back(lodJob);
     }
 
-    // Main loop for performing tasks
     while (true) {
+        // Covers transformations committed before the levels were ready
+        commitTransformedLod(store, history, lodJob, baseLod);
+        reportFinishedTasks(jobs);
+
         cout << "\nSelect a task to perform:\n";
         cout << "1. Calculate Surface Area\n";
         cout << "2. Calculate Volume\n";
         cout << "3. Calculate Center of Mass\n";
         cout << "4. Transform Polyhedron\n";
+        cout << "5. Background Tasks\n";
         cout << "6. Isometric View\n";
         cout << "7. Orthographic Projection onto Custom Plane\n";
         cout << "8. Calculate Moment of Inertia\n";
         cout << "9. Exit\n";
+        cout << "10. Full Analysis\n";
+        cout << "11. Slice with Parallel Planes\n";
+        cout << "12. Principal Axes and Oriented Bounding Box\n";
+        cout << "13. Instanced Scene\n";
+        cout << "14. Overlapping Instances\n";
+        cout << "15. Animate Transformations\n";
+        cout << "16. Convex Hull and Point Containment\n";
+        cout << "17. Deviation from a Reference Part\n";
         cout << "Enter your choice: ";
-        cin >> task;
+        if (!(cin >> task)) {
+            task = 9;  // End of input
+        }
 
         if (task == 9) {
             cout << "Exiting the program.\n";
@@ -48,77 +164,293 @@ int main() {
         }
 
         if (task == 4) {  // Transform Polyhedron
-            transform_polyhedron(poly);
+            if (transform_polyhedron(history)) {
+                store.commit(history.current());
+                commitTransformedLod(store, history, lodJob, baseLod);
+            }
+        }
+
+        if (task == 5) {
+            showTaskStatus(jobs);
         }
 
         if (task == 1) {  // Calculate Surface Area
-            float surfaceArea = calculateSurfaceArea(poly);
-            cout << "The Surface Area of the polyhedron is: " << surfaceArea << endl;
+            submitAnalysis(scheduler, store, jobs, "Surface Area", [=](const Polyhedron& poly, TaskState& state) {
+                AnalysisRecord record = analysePolyhedron(poly, origin, density, cache, CACHE_SURFACE_AREA, &state);
+                ostringstream out;
+                out << "The Surface Area of the polyhedron is: " << record.surfaceArea << endl;
+                return out.str();
+            });
         }
 
         if (task == 2) {  // Calculate Volume
-            float volume = calculatepolyhedronVolume(poly);
-            cout << "The Volume of the polyhedron is: " << volume << endl;
+            submitAnalysis(scheduler, store, jobs, "Volume", [=](const Polyhedron& poly, TaskState& state) {
+                AnalysisRecord record = analysePolyhedron(poly, origin, density, cache, CACHE_VOLUME, &state);
+                ostringstream out;
+                float volume = record.volume;
+                out << "The Volume of the polyhedron is: " << volume << endl;
+                return out.str();
+            });
         }
-        
+
         if (task == 3) {  // Calculate Centre of Mass
-            Vertex centre = calculateCenterOfMass(poly);
-            cout << "The Centre of Mass of the polyhedron is: " << centre.x << ", " << centre.y << ", " << centre.z << endl;
+            submitAnalysis(scheduler, store, jobs, "Centre of Mass", [=](const Polyhedron& poly, TaskState& state) {
+                AnalysisRecord record = analysePolyhedron(poly, origin, density, cache, CACHE_CENTER_OF_MASS, &state);
+                ostringstream out;
+                const Vertex& centre = record.centerOfMass;
+                out << "The Centre of Mass of the polyhedron is: " << centre.x << ", " << centre.y << ", " << centre.z << endl;
+                return out.str();
+            });
         }
 
         if (task == 8) {  // Calculate Moment of Inertia
+            submitAnalysis(scheduler, store, jobs, "Moment of Inertia", [=](const Polyhedron& poly, TaskState& state) {
+                AnalysisRecord record = analysePolyhedron(poly, origin, density, cache, CACHE_INERTIA, &state);
+                const InertiaTensor& inertia = record.inertia;
+                char text[256];
+                snprintf(text, sizeof(text), "Inertia Tensor: \nIxx: %lf, Iyy: %lf, Izz: %lf\nIxy: %lf, Ixz: %lf, Iyz: %lf\n",
+                         inertia.Ixx, inertia.Iyy, inertia.Izz, inertia.Ixy, inertia.Ixz, inertia.Iyz);
+                return string(text);
+            });
+        }
 
-            InertiaTensor inertia = computePolyhedronInertia(poly, origin, density);
-
-            // Output the computed inertia tensor
-            printf("Inertia Tensor: \nIxx: %lf, Iyy: %lf, Izz: %lf\n", inertia.Ixx, inertia.Iyy, inertia.Izz);
-            printf("Ixy: %lf, Ixz: %lf, Iyz: %lf\n", inertia.Ixy, inertia.Ixz, inertia.Iyz);
+        if (task == 10) {  // Every property in one task, cancellable between steps
+            submitAnalysis(scheduler, store, jobs, "Full Analysis", [=](const Polyhedron& poly, TaskState& state) {
+                AnalysisRecord record = analysePolyhedron(poly, origin, density, cache,
+                                                CACHE_SURFACE_AREA | CACHE_VOLUME | CACHE_CENTER_OF_MASS | CACHE_INERTIA, &state);
+                ostringstream out;
+                out << "Surface Area: " << record.surfaceArea << "\n";
+                out << "Volume: " << record.volume << "\n";
+                out << "Centre of Mass: " << record.centerOfMass.x << ", " << record.centerOfMass.y << ", " << record.centerOfMass.z << "\n";
+                out << "Inertia Ixx, Iyy, Izz: " << record.inertia.Ixx << ", " << record.inertia.Iyy << ", " << record.inertia.Izz << "\n";
+                out << "Inertia Ixy, Ixz, Iyz: " << record.inertia.Ixy << ", " << record.inertia.Ixz << ", " << record.inertia.Iyz << "\n";
+                return out.str();
+            });
         }
 
-        if (task == 6) {
+        if (task == 11) {  // Cross-sections with planes Ax + By + Cz = D for evenly spaced D
+            double A, B, C, firstD, lastD;
+            int count;
+            std::cout << "Enter the normal of the slicing planes (Ax + By + Cz = D):\n";
+            getValidatedDouble(A, "A (normal x-component): ");
+            getValidatedDouble(B, "B (normal y-component): ");
+            getValidatedDouble(C, "C (normal z-component): ");
+            getValidatedDouble(firstD, "First D: ");
+            getValidatedDouble(lastD, "Last D: ");
+            getValidatedChoice(count, 1, 1000000, "Number of slices: ");
 
-            SDL_Init(SDL_INIT_VIDEO);
+            if (A == 0 && B == 0 && C == 0) {
+                std::cout << "Error: The normal vector cannot be zero. Slicing canceled.\n";
+            } else {
+                vector<double> offsets(count);
+                for (int i = 0; i < count; ++i) {
+                    offsets[i] = count == 1 ? firstD : firstD + (lastD - firstD) * i / (count - 1);
+                }
+                submitAnalysis(scheduler, store, jobs, "Slicing", [=](const Polyhedron& poly, TaskState&) {
+                    vector<Slice> slices = slicePolyhedron(poly, A, B, C, offsets);
+                    ostringstream out;
+                    out << slices.size() << " slice(s):\n";
+                    for (const auto& slice : slices) {
+                        out << "  D = " << slice.offset << ": " << slice.contours.size() << " contour(s), area " << slice.area;
+                        if (slice.openChains) out << " (" << slice.openChains << " open chain(s))";
+                        out << "\n";
+                    }
+                    return out.str();
+                });
+            }
+        }
 
-            SDL_Window* window = SDL_CreateWindow("Isometric View", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-            SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        if (task == 12) {
+            submitAnalysis(scheduler, store, jobs, "Principal Axes", [=](const Polyhedron& poly, TaskState&) {
+                MassProperties props = computeMassProperties(poly, origin, density);
+                ostringstream out;
+                out << "Mass: " << props.mass << "\n";
+                out << "Centre of Mass: " << props.centerOfMass.x << ", " << props.centerOfMass.y << ", " << props.centerOfMass.z << "\n";
+                for (int k = 0; k < 3; ++k) {
+                    const Vertex& axis = props.principalAxes[k];
+                    out << "Principal moment " << k + 1 << ": " << props.principalMoments[k]
+                        << " about (" << axis.x << ", " << axis.y << ", " << axis.z << ")\n";
+                }
+                const OrientedBox& box = props.box;
+                out << "Oriented box centre: " << box.center.x << ", " << box.center.y << ", " << box.center.z << "\n";
+                out << "Oriented box half-extents: " << box.halfExtents[0] << ", " << box.halfExtents[1] << ", " << box.halfExtents[2] << "\n";
+                return out.str();
+            });
+        }
 
-            float angleX = 0.5f, angleY = 0.5f;
-            bool running = true;
+        if (task == 13) {  // Posed copies of the current polyhedron on a grid, all sharing its geometry
+            int count;
+            double spacing = 0, step = 0;
+            getValidatedChoice(count, 0, 1000000, "Number of instances (0 clears the scene): ");
+            if (count == 0) {
+                store.commitScene(nullptr);
+                cout << "Scene cleared.\n";
+            } else {
+                getValidatedDouble(spacing, "Grid spacing: ");
+                getValidatedDouble(step, "Rotation about the z-axis between instances (degrees): ");
 
-            while (running) {
-                SDL_Event event;
-                while (SDL_PollEvent(&event)) {
-                    if (event.type == SDL_QUIT) {
-                        running = false;
-                    } else if (event.type == SDL_MOUSEMOTION && (event.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT))) {
-                        angleX += event.motion.yrel * 0.01f;
-                        angleY += event.motion.xrel * 0.01f;
-                    }
+                shared_ptr<Scene> scene = make_shared<Scene>();
+                int mesh = scene->addMesh(store.snapshot());
+                int columns = static_cast<int>(ceil(sqrt(static_cast<double>(count))));
+                for (int i = 0; i < count; ++i) {
+                    AffineMap pose = translationMap((i % columns) * spacing, (i / columns) * spacing, 0) * rotationMap(i * step, 0, 0, 1);
+                    scene->addInstance(mesh, pose);
                 }
+                store.commitScene(scene);
 
-                SDL_SetRenderDrawColor(renderer, 245, 245, 245, 255); // Light gray background
-                SDL_RenderClear(renderer);
-
-                // Define colors for outer and inner polyhedrons
-                SDL_Color outerColor = {0, 100, 255, 255};  // Outer polyhedron color (e.g., blue)
-                SDL_Color innerColor = {255, 100, 100, 255}; // Inner polyhedron color (e.g., red)
+                submitAnalysis(scheduler, store, jobs, "Assembly", [=](const Polyhedron&, TaskState&) {
+                    MassProperties props = scene->massProperties(origin, density);
+                    ostringstream out;
+                    out << scene->instances().size() << " instance(s) of " << scene->numMeshes() << " mesh(es)\n";
+                    out << "Volume: " << props.volume << "\n";
+                    out << "Mass: " << props.mass << "\n";
+                    out << "Centre of Mass: " << props.centerOfMass.x << ", " << props.centerOfMass.y << ", " << props.centerOfMass.z << "\n";
+                    out << "Inertia Ixx, Iyy, Izz: " << props.inertia.Ixx << ", " << props.inertia.Iyy << ", " << props.inertia.Izz << "\n";
+                    out << "Inertia Ixy, Ixz, Iyz: " << props.inertia.Ixy << ", " << props.inertia.Ixz << ", " << props.inertia.Iyz << "\n";
+                    out << "Principal moments: " << props.principalMoments[0] << ", " << props.principalMoments[1] << ", " << props.principalMoments[2] << "\n";
+                    return out.str();
+                });
+            }
+        }
 
-                // Draw the outer polyhedron
-                drawPolyhedron(renderer, poly, angleX, angleY, outerColor);
+        if (task == 14) {
+            shared_ptr<const Scene> scene = store.sceneSnapshot();
+            if (!scene) {
+                cout << "There is no scene yet; build one with option 13.\n";
+            } else {
+                submitAnalysis(scheduler, store, jobs, "Overlaps", [=](const Polyhedron&, TaskState&) {
+                    OverlapReport report = findOverlaps(*scene);
+                    ostringstream out;
+                    out << report.pairs.size() << " overlapping pair(s) among " << report.instances << " instance(s) ("
+                        << report.candidatePairs << " candidate pair(s), " << report.convexTests << " by GJK, "
+                        << report.generalTests << " by triangle tests), " << report.shapeMemory.totalBytes()
+                        << " bytes of collision shapes\n";
+                    const size_t shown = 20;
+                    for (size_t i = 0; i < report.pairs.size() && i < shown; ++i) {
+                        const OverlapPair& pair = report.pairs[i];
+                        out << "  " << pair.a + 1 << " and " << pair.b + 1 << ", penetration about " << pair.penetration << "\n";
+                    }
+                    if (report.pairs.size() > shown) out << "  ... and " << report.pairs.size() - shown << " more\n";
+                    return out.str();
+                });
+            }
+        }
 
-                // Draw sub-polyhedrons with the distinct inner color
-                for (const auto& sub : poly.sub_polyhedrons) {
-                    drawPolyhedron(renderer, sub, angleX, angleY, innerColor);
+        if (task == 15) {  // Keyframes built one transformation at a time, each on top of the last pose
+            int count;
+            getValidatedChoice(count, 0, 1000, "Number of keyframes after the start (0 stops the animation): ");
+            if (count == 0) {
+                store.commitAnimation(nullptr);
+                cout << "Animation stopped.\n";
+            } else {
+                vector<Keyframe> keyframes(1);
+                keyframes[0].time = 0;
+                bool ok = true;
+                for (int i = 0; i < count && ok; ++i) {
+                    double seconds = 0;
+                    int choice;
+                    printf("Keyframe %d:\n", i + 1);
+                    getValidatedDouble(seconds, "Seconds after the previous keyframe: ");
+                    getValidatedChoice(choice, 1, 4, "Choose transformation:\n1. Rotate around a plane\n2. Translate\n3. Scale\n4. Reflect across a plane\n");
+                    TransformOp op;
+                    ok = promptTransformOp(choice, op);
+                    if (ok && seconds <= 0) {
+                        cout << "Error: Keyframes must be a positive time apart.\n";
+                        ok = false;
+                    }
+                    if (ok) {
+                        Keyframe key;
+                        key.time = keyframes.back().time + seconds;
+                        key.pose = transformOpMap(op) * keyframes.back().pose;
+                        keyframes.push_back(key);
+                    }
+                }
+                if (ok) {
+                    store.commitAnimation(make_shared<const Animation>(keyframes));
+                    printf("Playing %zu keyframes over %g seconds on a loop.\n", keyframes.size(), keyframes.back().time);
+                    ui.openIsometricView();
+                } else {
+                    cout << "Animation canceled.\n";
                 }
+            }
+        }
 
-                SDL_RenderPresent(renderer);
-                SDL_Delay(16); // Approximately 60 FPS
+        if (task == 16) {  // Hull of every shell; the points are located through the convex fast path where it applies
+            int count;
+            getValidatedChoice(count, 0, 1000, "Number of points to locate (0 for none): ");
+            vector<Vertex> probes(count);
+            for (int i = 0; i < count; ++i) {
+                printf("Point %d:\n", i + 1);
+                getValidatedDouble(probes[i].x, "x: ");
+                getValidatedDouble(probes[i].y, "y: ");
+                getValidatedDouble(probes[i].z, "z: ");
             }
+            submitAnalysis(scheduler, store, jobs, "Convex Hull", [=](const Polyhedron& poly, TaskState&) {
+                vector<ShellConvexity> shells = classifyShells(poly);
+                ostringstream out;
+                for (size_t s = 0; s < shells.size(); ++s) {
+                    const ShellConvexity& shell = shells[s];
+                    const ConvexHull& hull = shell.hull;
+                    out << "Shell " << s + 1 << (shell.depth == 0 ? " (outer)" : " (hole)") << ": "
+                        << (shell.convex ? "convex" : "not convex") << "\n";
+                    out << "  Volume " << shell.volume << ", hull volume " << hull.volume << "\n";
+                    out << "  Area " << shell.area << ", hull area " << hull.area << "\n";
+                    out << "  Hull of " << hull.vertices.size() << " vertices and " << hull.triangles.size() / 3 << " triangles\n";
+                }
+                out << "The solid is " << (isConvexSolid(shells) ? "convex" : "not convex") << "\n";
+                for (const Vertex& p : probes) {
+                    out << "Point " << p.x << ", " << p.y << ", " << p.z << ": "
+                        << (containsPoint(poly, shells, p) ? "inside" : "outside") << "\n";
+                }
+                return out.str();
+            });
+        }
 
-            SDL_DestroyRenderer(renderer);
-            SDL_DestroyWindow(window);
-            SDL_Quit();
+        if (task == 17) {  // The reference is a part from an archive written with --archive-add
+            string path;
+            int index;
+            cout << "Reference part archive: ";
+            cin >> path;
+            getValidatedChoice(index, 1, 1000000, "Part number in the archive (1 for the first): ");
+            if (!reference || path != referencePath || index != referenceIndex) {
+                ArchiveReader archive;
+                ArchivePart part;
+                bool found = archive.open(path);
+                for (int i = 1; i < index && found; ++i) {
+                    found = archive.skip();
+                }
+                if (found && archive.next(part)) {
+                    reference = make_shared<const Polyhedron>(move(part.poly));
+                    referencePath = path;
+                    referenceIndex = index;
+                } else {
+                    printf("Error: Could not read part %d of %s.\n", index, path.c_str());
+                    reference.reset();
+                }
+            }
+            if (reference) {
+                shared_ptr<const Polyhedron> measured = store.snapshot();
+                shared_ptr<const Polyhedron> against = reference;
+                shared_ptr<DeviationEngine> engine = deviationEngine;
+                jobs.push_back(scheduler.submit<string>("Deviation", [measured, against, engine, &store](TaskState& state) {
+                    DeviationReport report = engine->measure(measured, against, DEVIATION_SAMPLES, &state);
+                    store.commitDeviation(measured, make_shared<const DeviationReport>(report));
+                    ostringstream out;
+                    out << "Hausdorff distance " << report.hausdorff << " (part to reference " << report.measuredToReference
+                        << ", reference to part " << report.referenceToMeasured << ")\n";
+                    out << "  Mean deviation " << report.mean << ", RMS " << report.rms << " over "
+                        << report.measuredSamples + report.referenceSamples << " area samples\n";
+                    out << "  Surfaces built in " << report.buildSeconds << " s, measured in " << report.querySeconds << " s\n";
+                    out << "  The isometric view (6) colours each face from blue (no deviation) to red (the Hausdorff distance)\n"
+                        << "  once the view stops moving\n";
+                    return out.str();
+                }));
+                cout << "Started \"Deviation\" in the background (task " << jobs.size() << ").\n";
+            }
+        }
 
+        if (task == 6) {  // The viewer opens on the UI thread; the menu stays available
+            ui.openIsometricView();
         }
 
         if (task == 7) {
@@ -132,10 +464,168 @@ int main() {
             std::cin >> C;
             std::cout << "D (distance from origin): ";
             std::cin >> D;
-            orthographicProjectionCustomPlane(poly, A, B, C, D);
+            shared_ptr<const Polyhedron> snapshot = store.snapshot();
+            ui.post([snapshot, A, B, C, D]() {
+                orthographicProjectionCustomPlane(*snapshot, A, B, C, D);
+            });
+        }
+    }
+
+    // Wait for anything still running so its result is not lost silently
+    for (auto& job : jobs) job.result.wait();
+    reportFinishedTasks(jobs);
+}
+
+int main(int argc, char* argv[]) {
+    Polyhedron poly;
+    Vertex origin = {0, 0, 0};
+    double density = 1.0;
+    bool streamMode = false;
+    double weldTolerance = WELD_TOLERANCE;
+    string cachePath = ".polyhedron_cache";
+    bool serviceMode = false;
+    string socketPath;
+    string archiveAddPath, archiveScanPath;
+    int archiveBits = ARCHIVE_DEFAULT_BITS;
+    bool memoryReport = false;
+    string viewsPath;
+    double viewTolerance = RECONSTRUCTION_TOLERANCE;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--stream") == 0) {
+            streamMode = true;
+        } else if (strcmp(argv[i], "--weld") == 0 && i + 1 < argc) {
+            weldTolerance = atof(argv[++i]);  // 0 disables welding
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            cachePath.clear();
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            serviceMode = true;
+        } else if (strcmp(argv[i], "--serve-socket") == 0 && i + 1 < argc) {
+            serviceMode = true;
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--archive-add") == 0 && i + 1 < argc) {
+            archiveAddPath = argv[++i];
+        } else if (strcmp(argv[i], "--archive-scan") == 0 && i + 1 < argc) {
+            archiveScanPath = argv[++i];
+        } else if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc) {
+            archiveBits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0) {
+            memoryReport = true;
+        } else if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc) {
+            setAllocationLimit(strtoull(argv[++i], nullptr, 10));  // Bytes; allocations beyond it throw bad_alloc
+        } else if (strcmp(argv[i], "--views") == 0 && i + 1 < argc) {
+            viewsPath = argv[++i];
+        } else if (strcmp(argv[i], "--view-tolerance") == 0 && i + 1 < argc) {
+            viewTolerance = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--stream | --serve | --serve-socket path | --archive-scan path] [--weld tolerance] "
+                   "[--cache path | --no-cache] [--archive-add path [--bits n]] [--memory] [--memory-limit bytes] "
+                   "[--views path] [--view-tolerance t]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Vertices are read as their projections in each view: xy and xz unless a calibrated view set is given
+    vector<ProjectionView> views = standardViews();
+    if (!viewsPath.empty() && !loadViews(viewsPath, views)) {
+        return 1;
+    }
+    Reconstructor reconstructor(views, viewTolerance);
+    if (!reconstructor.solvable()) {
+        fprintf(stderr, "The views do not determine all three coordinates\n");
+        return 1;
+    }
+
+    // Streaming mode: read the model from stdin without prompts and report everything in one pass
+    if (streamMode) {
+        StreamResult result = streamAnalyse(stdin, reconstructor, origin, density, weldTolerance);
+        printStreamResult(result);
+        return result.valid ? 0 : 1;
+    }
+
+    if (!archiveScanPath.empty()) {
+        return scanArchive(archiveScanPath, origin, density);
+    }
+
+    // Results are keyed by content, so an unchanged part skips straight to the cached outcome
+    ResultCache cache;
+    if (!cachePath.empty() && !cache.open(cachePath)) {
+        fprintf(stderr, "Could not open result cache %s; continuing without it\n", cachePath.c_str());
+    }
+
+    // Service mode: keep models resident and answer JSON-line requests until told to stop
+    if (serviceMode) {
+        return runService(socketPath, cache.isOpen() ? &cache : nullptr, weldTolerance);
+    }
+
+    ReconstructionReport reconstruction;
+    getInput(poly, reconstructor, reconstruction, "outer");
+    printReconstructionReport(reconstruction);
+
+    // Merge near-coincident vertices so closedness checks see shared edges
+    WeldReport weld = weldPolyhedron(poly, weldTolerance);
+    printWeldReport(weld);
+
+    // Make face windings consistent so the signed mass-property kernels apply
+    OrientationReport orientation = orientPolyhedron(poly);
+    printOrientationReport(orientation);
+
+    printPolyhedron(poly, "outer", 1);
+
+    // Footprint of the model as loaded, with the face groups every analysis builds from it
+    if (memoryReport) {
+        FaceMesh mesh = buildFaceMesh(poly);
+        printMemoryReport(measurePolyhedron(poly, &mesh));
+        printAllocationStats(allocationStats());
+    }
+
+    // Validate the input
+    AnalysisRecord record = AnalysisRecord();
+    record.key = hashPolyhedron(poly, origin, density);
+    bool isValid;
+    if (cache.isOpen() && cache.lookup(record.key, record) && (record.flags & CACHE_VALIDATED)) {
+        isValid = (record.flags & CACHE_VALID) != 0;
+        cout << "Validation result loaded from cache.\n";
+    } else {
+        isValid = validateInput(poly);
+        record.flags = CACHE_VALIDATED | (isValid ? CACHE_VALID : 0u);
+        cache.store(record);
+    }
+    
+    if (isValid) {
+        cout << "The input and reconstruction are valid.\n";
+    } else {
+        cout << "The input or reconstruction is invalid.\n";
+        return 1;  // Exit if the input is invalid
+    }
+
+    // Parts are named by their content hash, the same key the result cache uses
+    if (!archiveAddPath.empty()) {
+        ArchiveWriter archive;
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(record.key));
+        if (archive.open(archiveAddPath) && archive.add(name, poly, archiveBits)) {
+            cout << "Added part " << name << " to " << archiveAddPath << ".\n";
+        } else {
+            fprintf(stderr, "Could not add the part to archive %s\n", archiveAddPath.c_str());
         }
     }
 
+    // Analysis runs on worker threads and SDL on this thread, so the menu
+    // gets its own thread and neither ever waits for the other
+    GeometryStore store;
+    store.commit(poly);
+    TaskScheduler scheduler;
+    UiHost ui(store);
+
+    thread menuThread([&]() {
+        runMenu(store, scheduler, ui, cache.isOpen() ? &cache : nullptr, origin, density);
+        ui.shutdown();
+    });
+    ui.run();
+    menuThread.join();
 
     return 0;
 }
@@ -0,0 +1,139 @@
+#include "memory.h"
+#include "facemesh.h"
+#include "lod.h"
+
+#include <atomic>
+
+using namespace std;
+
+MemoryFootprint& MemoryFootprint::operator+=(const MemoryFootprint& other) {
+    vertexBytes += other.vertexBytes;
+    topologyBytes += other.topologyBytes;
+    edgeCopyBytes += other.edgeCopyBytes;
+    triangulationBytes += other.triangulationBytes;
+    bvhBytes += other.bvhBytes;
+    slackBytes += other.slackBytes;
+    allocations += other.allocations;
+    return *this;
+}
+
+static void accountFaceGroup(const FaceGroup& group, MemoryFootprint& footprint) {
+    accountVector(group.indices, footprint.triangulationBytes, footprint);
+    accountVector(group.starts, footprint.triangulationBytes, footprint);
+    accountVector(group.faceIds, footprint.triangulationBytes, footprint);
+}
+
+static void appendShells(const Polyhedron& poly, int depth, const FaceMesh* mesh, const PolyhedronLod* lod,
+                         size_t& lodIndex, MemoryReport& report) {
+    ShellFootprint shell;
+    shell.depth = depth;
+    shell.faces = poly.faces.size();
+    MemoryFootprint& m = shell.memory;
+
+    accountVector(poly.vertices, m.vertexBytes, m);
+    accountVector(poly.faces, m.topologyBytes, m);
+    for (const Face& face : poly.faces) {
+        accountVector(face.edges, m.topologyBytes, m);
+        m.edgeCopyBytes += face.edges.size() * 2 * sizeof(Vertex);
+    }
+    // The holes' own contents are counted in their rows
+    accountVector(poly.sub_polyhedrons, m.topologyBytes, m);
+
+    if (mesh) {
+        accountVector(mesh->vertices, m.triangulationBytes, m);
+        accountFaceGroup(mesh->triangles, m);
+        accountFaceGroup(mesh->quads, m);
+        accountFaceGroup(mesh->polygons, m);
+        accountVector(mesh->holes, m.triangulationBytes, m);
+    }
+    if (lod && lodIndex < lod->shells.size()) {
+        const LodChain& chain = lod->shells[lodIndex];
+        accountVector(chain.levels, m.triangulationBytes, m);
+        for (const LodLevel& level : chain.levels) {
+            accountVector(level.vertices, m.triangulationBytes, m);
+            accountVector(level.edges, m.triangulationBytes, m);
+        }
+    }
+    ++lodIndex;
+
+    report.total += m;
+    report.shells.push_back(shell);
+    for (size_t i = 0; i < poly.sub_polyhedrons.size(); ++i) {
+        const FaceMesh* holeMesh = mesh && i < mesh->holes.size() ? &mesh->holes[i] : nullptr;
+        appendShells(poly.sub_polyhedrons[i], depth + 1, holeMesh, lod, lodIndex, report);
+    }
+}
+
+MemoryReport measurePolyhedron(const Polyhedron& poly, const FaceMesh* mesh, const PolyhedronLod* lod) {
+    MemoryReport report;
+    size_t lodIndex = 0;
+    appendShells(poly, 0, mesh, lod, lodIndex, report);
+    return report;
+}
+
+static void printFootprintRow(const char* label, const MemoryFootprint& m) {
+    printf("%-12s %12zu %12zu %12zu %12zu %12zu %12zu %10zu %12zu\n", label, m.vertexBytes, m.topologyBytes,
+           m.edgeCopyBytes, m.triangulationBytes, m.bvhBytes, m.slackBytes, m.allocations, m.totalBytes());
+}
+
+void printMemoryReport(const MemoryReport& report) {
+    printf("%-12s %12s %12s %12s %12s %12s %12s %10s %12s\n", "Shell", "Vertices", "Topology", "(Edge copy)",
+           "Triangles", "BVH", "Slack", "Blocks", "Total");
+    for (size_t i = 0; i < report.shells.size(); ++i) {
+        char label[32];
+        if (i == 0) {
+            snprintf(label, sizeof(label), "outer");
+        } else {
+            snprintf(label, sizeof(label), "%*shole %zu", 2 * report.shells[i].depth - 2, "", i);
+        }
+        printFootprintRow(label, report.shells[i].memory);
+    }
+    printFootprintRow("total", report.total);
+}
+
+// Written by operator new and delete from any thread, possibly before main
+static atomic<bool> trackingOn(false);
+static atomic<size_t> liveBytes(0), peakBytes(0), liveBlocks(0), allocationCount(0), allocationLimit(0);
+
+bool allocationAllowed(size_t bytes) {
+    size_t limit = allocationLimit.load(memory_order_relaxed);
+    return limit == 0 || liveBytes.load(memory_order_relaxed) + bytes <= limit;
+}
+
+void noteAllocation(size_t bytes) {
+    trackingOn.store(true, memory_order_relaxed);
+    size_t live = liveBytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+    liveBlocks.fetch_add(1, memory_order_relaxed);
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    size_t peak = peakBytes.load(memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+    }
+}
+
+void noteRelease(size_t bytes) {
+    liveBytes.fetch_sub(bytes, memory_order_relaxed);
+    liveBlocks.fetch_sub(1, memory_order_relaxed);
+}
+
+AllocationStats allocationStats() {
+    AllocationStats stats;
+    stats.tracking = trackingOn.load(memory_order_relaxed);
+    stats.liveBytes = liveBytes.load(memory_order_relaxed);
+    stats.peakBytes = peakBytes.load(memory_order_relaxed);
+    stats.liveBlocks = liveBlocks.load(memory_order_relaxed);
+    stats.allocations = allocationCount.load(memory_order_relaxed);
+    return stats;
+}
+
+void setAllocationLimit(size_t bytes) {
+    allocationLimit.store(bytes, memory_order_relaxed);
+}
+
+void printAllocationStats(const AllocationStats& stats) {
+    if (!stats.tracking) {
+        printf("Heap tracking is not built in\n");
+        return;
+    }
+    printf("Heap: %zu bytes live in %zu blocks, peak %zu bytes, %zu allocations since start-up\n",
+           stats.liveBytes, stats.liveBlocks, stats.peakBytes, stats.allocations);
+}
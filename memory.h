@@ -0,0 +1,77 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "input.h"
+
+struct FaceMesh;
+struct PolyhedronLod;
+
+// Heap bytes held by a structure, by what they are for. Sizes are element
+// counts times element sizes plus the containers' own headers nested inside
+// other containers; allocator bookkeeping is not included.
+struct MemoryFootprint {
+    size_t vertexBytes;         // Vertex tables
+    size_t topologyBytes;       // Faces, their edge vectors and the hole vectors
+    size_t edgeCopyBytes;       // Part of topologyBytes: the v1/v2 Vertex copies inside every Edge
+    size_t triangulationBytes;  // Face groups (FaceMesh) and simplified levels (LodChain)
+    size_t bvhBytes;            // Collision shapes: points, triangles and BVH nodes
+    size_t slackBytes;          // Capacity reserved beyond size, on top of the above
+    size_t allocations;         // Heap blocks, one per vector with capacity
+
+    MemoryFootprint() : vertexBytes(0), topologyBytes(0), edgeCopyBytes(0), triangulationBytes(0), bvhBytes(0),
+                        slackBytes(0), allocations(0) {}
+
+    size_t totalBytes() const { return vertexBytes + topologyBytes + triangulationBytes + bvhBytes + slackBytes; }
+    MemoryFootprint& operator+=(const MemoryFootprint& other);
+};
+
+// Adds one vector's payload to `bytes` and its spare capacity and block to the footprint
+template <typename T>
+inline void accountVector(const vector<T>& v, size_t& bytes, MemoryFootprint& footprint) {
+    bytes += v.size() * sizeof(T);
+    footprint.slackBytes += (v.capacity() - v.size()) * sizeof(T);
+    if (v.capacity() > 0) footprint.allocations++;
+}
+
+struct ShellFootprint {
+    int depth;       // 0 for the outer shell, 1 for its holes, and so on
+    size_t faces;
+    MemoryFootprint memory;
+};
+
+struct MemoryReport {
+    vector<ShellFootprint> shells;  // Outer shell first, then holes depth-first
+    MemoryFootprint total;
+};
+
+// Per-shell footprint of a loaded polyhedron. The optional face groups and
+// levels of detail must have been built from it; their shells are matched
+// up in the same depth-first order.
+MemoryReport measurePolyhedron(const Polyhedron& poly, const FaceMesh* mesh = nullptr, const PolyhedronLod* lod = nullptr);
+
+void printMemoryReport(const MemoryReport& report);
+
+// Process-wide heap counters kept by the replaced operator new and delete
+// (allocation.cpp). `tracking` stays false in a build without them.
+struct AllocationStats {
+    bool tracking;
+    size_t liveBytes;     // Usable size of every block not yet freed
+    size_t peakBytes;
+    size_t liveBlocks;
+    size_t allocations;   // Since start-up
+};
+
+AllocationStats allocationStats();
+// Makes operator new throw bad_alloc instead of growing the heap past
+// `bytes`; 0 lifts the limit. Meant for batch workers sharing one machine.
+void setAllocationLimit(size_t bytes);
+
+void printAllocationStats(const AllocationStats& stats);
+
+// Hooks for allocation.cpp: whether a request of `bytes` fits the limit, and
+// the usable size of each block as it is handed out and given back
+bool allocationAllowed(size_t bytes);
+void noteAllocation(size_t bytes);
+void noteRelease(size_t bytes);
+
+#endif
@@ -0,0 +1,342 @@
+#include "polyapi.h"
+#include "facemesh.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <new>
+#include <type_traits>
+
+using namespace std;
+
+// The caller's buffers are read in place as the kernels' own types
+static_assert(sizeof(Vertex) == 3 * sizeof(double) && is_standard_layout<Vertex>::value,
+              "Vertex must alias three packed doubles");
+static_assert(is_same<int32_t, int>::value, "face indices must alias int");
+
+static const Vertex* shellVertices(const poly_shell& shell) {
+    return reinterpret_cast<const Vertex*>(shell.xyz);
+}
+
+static bool shellReadable(const poly_shell& shell) {
+    if (shell.num_vertices < 0 || shell.num_faces < 0) return false;
+    if (shell.num_faces > 0 && (!shell.face_sizes || !shell.indices)) return false;
+    return shell.num_vertices == 0 || shell.xyz;
+}
+
+static bool shellsReadable(const poly_shell* shells, size_t count) {
+    if (count > 0 && !shells) return false;
+    for (size_t s = 0; s < count; ++s) {
+        if (!shellReadable(shells[s])) return false;
+    }
+    return true;
+}
+
+// The kernels trust every index, so every face is checked before any runs:
+// at least three vertices, all of them in the shell
+static poly_status checkFaces(const poly_shell* shells, size_t count) {
+    for (size_t s = 0; s < count; ++s) {
+        const poly_shell& shell = shells[s];
+        const int* idx = shell.indices;
+        for (int f = 0; f < shell.num_faces; ++f) {
+            int n = shell.face_sizes[f];
+            if (n < 3) return POLY_INVALID_ARGUMENT;
+            for (int i = 0; i < n; ++i) {
+                if (idx[i] < 0 || idx[i] >= shell.num_vertices) return POLY_INDEX_OUT_OF_RANGE;
+            }
+            idx += n;
+        }
+    }
+    return POLY_OK;
+}
+
+// Calls fn(idx, n, face) for every face of the shell in order. Callers pick
+// the kernel for n = 3 and 4 so those still unroll, as with FaceMesh groups.
+template <typename Fn>
+static void forEachShellFace(const poly_shell& shell, Fn fn) {
+    const int* idx = shell.indices;
+    for (int f = 0; f < shell.num_faces; ++f) {
+        int n = shell.face_sizes[f];
+        fn(idx, n, f);
+        idx += n;
+    }
+}
+
+template <int N>
+static double faceSurfaceArea(const Vertex* vertices, const int* idx, int n) {
+    Vertex area = faceVectorArea<N>(vertices, idx, n);
+    return sqrt(area.x * area.x + area.y * area.y + area.z * area.z) / 2.0;
+}
+
+// Shoelace area of the face projected on the plane with unit normal `normal`,
+// which is its vector area along that normal
+template <int N>
+static double faceShadowArea(const Vertex* vertices, const int* idx, int n, const Vertex& normal) {
+    Vertex area = faceVectorArea<N>(vertices, idx, n);
+    double twice = area.x * normal.x + area.y * normal.y + area.z * normal.z;
+    return twice > 0 ? twice / 2.0 : 0.0;
+}
+
+extern "C" {
+
+uint32_t poly_api_version(void) {
+    return POLY_API_VERSION;
+}
+
+double poly_surface_area(const poly_shell* shells, size_t count) {
+    if (!shellsReadable(shells, count) || checkFaces(shells, count) != POLY_OK) return 0;
+    double total = 0;
+    for (size_t s = 0; s < count; ++s) {
+        if (shells[s].depth != 0) continue;
+        const Vertex* vertices = shellVertices(shells[s]);
+        forEachShellFace(shells[s], [&](const int* idx, int n, int) {
+            total += n == 3 ? faceSurfaceArea<3>(vertices, idx, n)
+                   : n == 4 ? faceSurfaceArea<4>(vertices, idx, n)
+                            : faceSurfaceArea<0>(vertices, idx, n);
+        });
+    }
+    return total;
+}
+
+poly_status poly_mass_properties_of(const poly_shell* shells, size_t count, const double origin[3], double density,
+                                    poly_mass_properties* out) {
+    if (!shellsReadable(shells, count) || !origin || !out) return POLY_INVALID_ARGUMENT;
+    poly_status status = checkFaces(shells, count);
+    if (status != POLY_OK) return status;
+
+    Vertex about = {origin[0], origin[1], origin[2]};
+    VolumeIntegrals sums;
+    for (size_t s = 0; s < count; ++s) {
+        const Vertex* vertices = shellVertices(shells[s]);
+        forEachShellFace(shells[s], [&](const int* idx, int n, int) {
+            if (n == 3) accumulateFaceIntegrals<3>(vertices, idx, n, about, sums);
+            else if (n == 4) accumulateFaceIntegrals<4>(vertices, idx, n, about, sums);
+            else accumulateFaceIntegrals<0>(vertices, idx, n, about, sums);
+        });
+    }
+    MassProperties props = massPropertiesFromIntegrals(sums, about, density);
+    if (count > 0) fitOrientedBox(props, shellVertices(shells[0]), shells[0].num_vertices);
+
+    auto copyTensor = [](const InertiaTensor& t, double* to) {
+        to[0] = t.Ixx;
+        to[1] = t.Iyy;
+        to[2] = t.Izz;
+        to[3] = t.Ixy;
+        to[4] = t.Ixz;
+        to[5] = t.Iyz;
+    };
+    auto copyVertex = [](const Vertex& v, double* to) {
+        to[0] = v.x;
+        to[1] = v.y;
+        to[2] = v.z;
+    };
+    out->volume = props.volume;
+    out->mass = props.mass;
+    copyVertex(props.centerOfMass, out->center_of_mass);
+    copyTensor(props.inertia, out->inertia);
+    copyTensor(props.centralInertia, out->central_inertia);
+    for (int k = 0; k < 3; ++k) {
+        out->principal_moments[k] = props.principalMoments[k];
+        copyVertex(props.principalAxes[k], out->principal_axes[k]);
+        out->box_half_extents[k] = props.box.halfExtents[k];
+    }
+    copyVertex(props.box.center, out->box_center);
+    return POLY_OK;
+}
+
+double poly_projected_area(const poly_shell* shells, size_t count, double a, double b, double c) {
+    double length = sqrt(a * a + b * b + c * c);
+    if (!shellsReadable(shells, count) || length == 0 || checkFaces(shells, count) != POLY_OK) return 0;
+    Vertex normal = {a / length, b / length, c / length};
+    double total = 0;
+    for (size_t s = 0; s < count; ++s) {
+        if (shells[s].depth != 0) continue;
+        const Vertex* vertices = shellVertices(shells[s]);
+        forEachShellFace(shells[s], [&](const int* idx, int n, int) {
+            total += n == 3 ? faceShadowArea<3>(vertices, idx, n, normal)
+                   : n == 4 ? faceShadowArea<4>(vertices, idx, n, normal)
+                            : faceShadowArea<0>(vertices, idx, n, normal);
+        });
+    }
+    return total;
+}
+
+size_t poly_validation_scratch_size(const poly_shell* shells, size_t count) {
+    if (!shellsReadable(shells, count)) return 0;
+    size_t largest = 0;
+    for (size_t s = 0; s < count; ++s) {
+        size_t corners = 0;
+        for (int f = 0; f < shells[s].num_faces; ++f) {
+            if (shells[s].face_sizes[f] > 0) corners += shells[s].face_sizes[f];
+        }
+        largest = max(largest, corners);
+    }
+    return largest;
+}
+
+// Undirected edge as (smaller index, larger index) in one word, so sorting
+// brings the copies of each edge together
+static uint64_t edgeKey(int a, int b) {
+    if (a > b) swap(a, b);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+
+// First face using the edge of `key`, for the report
+static int32_t faceWithEdge(const poly_shell& shell, uint64_t key) {
+    int32_t found = -1;
+    forEachShellFace(shell, [&](const int* idx, int n, int f) {
+        for (int i = 0; i < n && found < 0; ++i) {
+            if (edgeKey(idx[i], idx[i + 1 < n ? i + 1 : 0]) == key) found = f;
+        }
+    });
+    return found;
+}
+
+static poly_defect validateShell(const poly_shell& shell, uint64_t* keys, int32_t& face) {
+    const Vertex* vertices = shellVertices(shell);
+    face = -1;
+    forEachShellFace(shell, [&](const int* idx, int n, int f) {
+        if (face >= 0) return;
+        bool collinear = n == 3 ? faceHasCollinearRun<3>(vertices, idx, n)
+                       : n == 4 ? faceHasCollinearRun<4>(vertices, idx, n)
+                                : faceHasCollinearRun<0>(vertices, idx, n);
+        if (collinear) face = f;
+    });
+    if (face >= 0) return POLY_DEFECT_COLLINEAR;
+    forEachShellFace(shell, [&](const int* idx, int n, int f) {
+        if (face >= 0) return;
+        bool planar = n == 3 ? faceIsPlanar<3>(vertices, idx, n)
+                    : n == 4 ? faceIsPlanar<4>(vertices, idx, n)
+                             : faceIsPlanar<0>(vertices, idx, n);
+        if (!planar) face = f;
+    });
+    if (face >= 0) return POLY_DEFECT_NON_PLANAR;
+
+    size_t used = 0;
+    forEachShellFace(shell, [&](const int* idx, int n, int) {
+        for (int i = 0; i < n; ++i) keys[used++] = edgeKey(idx[i], idx[i + 1 < n ? i + 1 : 0]);
+    });
+    sort(keys, keys + used);
+    for (size_t i = 0; i < used;) {
+        size_t run = 1;
+        while (i + run < used && keys[i + run] == keys[i]) ++run;
+        if (run != 2) {
+            face = faceWithEdge(shell, keys[i]);
+            return POLY_DEFECT_OPEN_EDGE;
+        }
+        i += run;
+    }
+    return POLY_DEFECT_NONE;
+}
+
+poly_status poly_validate(const poly_shell* shells, size_t count, uint64_t* scratch, poly_validation* out) {
+    if (!shellsReadable(shells, count) || !out) return POLY_INVALID_ARGUMENT;
+    out->shell = -1;
+    out->face = -1;
+    out->defect = POLY_DEFECT_NONE;
+    poly_status status = checkFaces(shells, count);
+    if (status != POLY_OK) return status;
+
+    vector<uint64_t> owned;
+    if (!scratch) {
+        try {
+            owned.resize(poly_validation_scratch_size(shells, count));
+        } catch (const bad_alloc&) {
+            return POLY_OUT_OF_MEMORY;
+        }
+        scratch = owned.data();
+    }
+    for (size_t s = 0; s < count; ++s) {
+        int32_t face;
+        poly_defect defect = validateShell(shells[s], scratch, face);
+        if (defect != POLY_DEFECT_NONE) {
+            out->shell = static_cast<int32_t>(s);
+            out->face = face;
+            out->defect = defect;
+            break;
+        }
+    }
+    return POLY_OK;
+}
+
+static void storeMap(const AffineMap& map, double m[12]) {
+    for (int r = 0; r < 3; ++r) {
+        for (int k = 0; k < 3; ++k) m[4 * r + k] = map.linear(r, k);
+        m[4 * r + 3] = map.translation(r);
+    }
+}
+
+static AffineMap loadMap(const double m[12]) {
+    AffineMap map;
+    for (int r = 0; r < 3; ++r) {
+        for (int k = 0; k < 3; ++k) map.linear(r, k) = m[4 * r + k];
+        map.translation(r) = m[4 * r + 3];
+    }
+    return map;
+}
+
+poly_status poly_rotation(double angle, double a, double b, double c, double m[12]) {
+    if (a == 0 && b == 0 && c == 0) return POLY_INVALID_ARGUMENT;
+    storeMap(rotationMap(angle, a, b, c), m);
+    return POLY_OK;
+}
+
+void poly_translation(double dx, double dy, double dz, double m[12]) {
+    storeMap(translationMap(dx, dy, dz), m);
+}
+
+void poly_scaling(double sx, double sy, double sz, double m[12]) {
+    storeMap(scaleMap(sx, sy, sz), m);
+}
+
+poly_status poly_reflection(double a, double b, double c, double d, double m[12]) {
+    if (a == 0 && b == 0 && c == 0) return POLY_INVALID_ARGUMENT;
+    storeMap(reflectionMap(a, b, c, d), m);
+    return POLY_OK;
+}
+
+void poly_compose(const double first[12], const double second[12], double out[12]) {
+    storeMap(loadMap(first) * loadMap(second), out);
+}
+
+void poly_transform_points(const double m[12], const double* xyz, size_t count, double* out) {
+    for (size_t i = 0; i < count; ++i) {
+        double x = xyz[3 * i], y = xyz[3 * i + 1], z = xyz[3 * i + 2];
+        for (int r = 0; r < 3; ++r) {
+            out[3 * i + r] = m[4 * r] * x + m[4 * r + 1] * y + m[4 * r + 2] * z + m[4 * r + 3];
+        }
+    }
+}
+
+poly_status poly_plane_basis(double a, double b, double c, double u[3], double v[3]) {
+    if (a == 0 && b == 0 && c == 0) return POLY_INVALID_ARGUMENT;
+    Vector3d uAxis, vAxis;
+    planeBasis(a, b, c, uAxis, vAxis);
+    for (int k = 0; k < 3; ++k) {
+        u[k] = uAxis(k);
+        v[k] = vAxis(k);
+    }
+    return POLY_OK;
+}
+
+poly_status poly_project_onto_plane(const double* xyz, size_t count, double a, double b, double c, double* uv) {
+    if (a == 0 && b == 0 && c == 0) return POLY_INVALID_ARGUMENT;
+    Vector3d u, v;
+    planeBasis(a, b, c, u, v);
+    for (size_t i = 0; i < count; ++i) {
+        const double* p = xyz + 3 * i;
+        uv[2 * i] = p[0] * u.x() + p[1] * u.y() + p[2] * u.z();
+        uv[2 * i + 1] = p[0] * v.x() + p[1] * v.y() + p[2] * v.z();
+    }
+    return POLY_OK;
+}
+
+void poly_isometric_matrix(double angle_x, double angle_y, double p[6]) {
+    double P[2][3];
+    isometricMatrix(static_cast<float>(angle_x), static_cast<float>(angle_y), P);
+    for (int k = 0; k < 3; ++k) {
+        p[k] = P[0][k];
+        p[3 + k] = P[1][k];
+    }
+}
+
+}
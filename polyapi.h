@@ -0,0 +1,125 @@
+#ifndef POLYAPI_H
+#define POLYAPI_H
+
+/*
+ * C interface to the geometry kernels, built into libpolyhedron.a and
+ * libpolyhedron.so without the interactive front end or SDL.
+ *
+ * Every function works on buffers owned by the caller and reads them in
+ * place: nothing is copied, kept after the call returns, printed or
+ * allocated (poly_validate allocates only when it is given no scratch).
+ * All functions are safe to call from any number of threads at once.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a struct layout or a function signature changes */
+#define POLY_API_VERSION 1
+
+typedef enum poly_status {
+    POLY_OK = 0,
+    POLY_INVALID_ARGUMENT = 1,   /* Null pointer, negative count, face of fewer than 3 vertices or zero plane normal */
+    POLY_INDEX_OUT_OF_RANGE = 2, /* A face index outside 0 .. num_vertices - 1 */
+    POLY_OUT_OF_MEMORY = 3
+} poly_status;
+
+/*
+ * One closed shell, borrowed from the caller. A solid is an array of shells:
+ * the outer shell first (depth 0), then its holes (depth 1) and any shells
+ * nested inside those, depth-first. Faces wind counter-clockwise seen from
+ * outside the material, so hole faces point into the cavity and the holes'
+ * volumes subtract themselves, as after orientPolyhedron.
+ */
+typedef struct poly_shell {
+    const double* xyz;          /* x, y, z of each vertex, 3 * num_vertices doubles */
+    int32_t num_vertices;
+    const int32_t* face_sizes;  /* Vertex count of each face */
+    const int32_t* indices;     /* 0-based vertex loops of all faces, one after the other */
+    int32_t num_faces;
+    int32_t depth;
+} poly_shell;
+
+typedef struct poly_mass_properties {
+    double volume;
+    double mass;
+    double center_of_mass[3];
+    double inertia[6];              /* Ixx, Iyy, Izz, Ixy, Ixz, Iyz about the origin passed in */
+    double central_inertia[6];      /* The same about the centre of mass */
+    double principal_moments[3];    /* Ascending */
+    double principal_axes[3][3];    /* Unit eigenvectors of central_inertia, one per row, right-handed */
+    double box_center[3];           /* Box along the principal axes around the outer shell */
+    double box_half_extents[3];
+} poly_mass_properties;
+
+typedef enum poly_defect {
+    POLY_DEFECT_NONE = 0,
+    POLY_DEFECT_COLLINEAR = 1,      /* Three consecutive face vertices on a line */
+    POLY_DEFECT_NON_PLANAR = 2,
+    POLY_DEFECT_OPEN_EDGE = 3       /* An edge not shared by exactly two faces */
+} poly_defect;
+
+typedef struct poly_validation {
+    int32_t shell;      /* First failing shell, or -1 */
+    int32_t face;       /* First failing face of that shell, or -1 */
+    poly_defect defect;
+} poly_validation;
+
+uint32_t poly_api_version(void);
+
+/*
+ * Every function taking shells checks them before reading any vertex: the
+ * pointers, every face size (at least 3) and every index. The functions that
+ * return a status report the first problem; the area functions return 0.
+ */
+
+/* Surface area of the depth-0 shells */
+double poly_surface_area(const poly_shell* shells, size_t count);
+
+/* Volume, centre of mass and inertia of the solid, holes included */
+poly_status poly_mass_properties_of(const poly_shell* shells, size_t count, const double origin[3], double density,
+                                    poly_mass_properties* out);
+
+/* Area of the outer shells' shadow on the plane with normal (a, b, c) */
+double poly_projected_area(const poly_shell* shells, size_t count, double a, double b, double c);
+
+/*
+ * The checks of validateInput. Edges are matched by vertex index, so
+ * coincident vertices must be welded beforehand. `scratch` holds
+ * poly_validation_scratch_size() entries and may be null, in which case the
+ * call allocates its own. Returns POLY_OK whether or not a defect is found;
+ * `out` says which.
+ */
+size_t poly_validation_scratch_size(const poly_shell* shells, size_t count);
+poly_status poly_validate(const poly_shell* shells, size_t count, uint64_t* scratch, poly_validation* out);
+
+/*
+ * Affine maps as 3x4 row-major matrices [L | t]: x' = L x + t. The builders
+ * follow the conventions of the menu's transformations: angles in degrees
+ * about the axis (a, b, c), reflection across the plane ax + by + cz = d.
+ */
+poly_status poly_rotation(double angle, double a, double b, double c, double m[12]);
+void poly_translation(double dx, double dy, double dz, double m[12]);
+void poly_scaling(double sx, double sy, double sz, double m[12]);
+poly_status poly_reflection(double a, double b, double c, double d, double m[12]);
+/* out = first applied after second; out may alias either */
+void poly_compose(const double first[12], const double second[12], double out[12]);
+/* Maps `count` points from xyz into out, which may be xyz itself */
+void poly_transform_points(const double m[12], const double* xyz, size_t count, double* out);
+
+/* Orthonormal in-plane axes u, v of the plane with normal (a, b, c), with u x v along the normal */
+poly_status poly_plane_basis(double a, double b, double c, double u[3], double v[3]);
+/* Writes the (u, v) coordinates of each point on that plane into uv, 2 * count doubles */
+poly_status poly_project_onto_plane(const double* xyz, size_t count, double a, double b, double c, double* uv);
+/* The viewer's isometric projection without its screen offset, as a 2x3 row-major matrix */
+void poly_isometric_matrix(double angle_x, double angle_y, double p[6]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,8 +3,19 @@
 
 #include "input.h"
 
-void orthographicProjectionCustomPlane(const Polyhedron& poly, float A, float B, float C, float D);
+struct Point2D {
+    double u, v;
+};
+
+// Orthonormal in-plane axes for a plane with normal (A, B, C), with u x v along the normal
+void planeBasis(double A, double B, double C, Vector3d& u, Vector3d& v);
+
+// Orthographic projection of each vertex onto the plane Ax + By + Cz = D,
+// in an orthonormal (u, v) basis of that plane. Pure: no SDL involved.
+vector<Point2D> projectVerticesOntoPlane(const vector<Vertex>& vertices, double A, double B, double C, double D);
+
 SDL_Point projectTo2D(Vertex v, float angleX, float angleY);
-void drawPolyhedron(SDL_Renderer* renderer, const Polyhedron& polyhedron, float angleX, float angleY, SDL_Color color);
+// Linear part of projectTo2D: screen = P v + (SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2)
+void isometricMatrix(float angleX, float angleY, double P[2][3]);
 
 #endif
\ No newline at end of file
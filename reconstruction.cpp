@@ -0,0 +1,131 @@
+#include "reconstruction.h"
+
+using namespace std;
+using namespace Eigen;
+
+// Solutions are written straight into the caller's Vertex array
+static_assert(sizeof(Vertex) == 3 * sizeof(double), "Vertex must alias three packed doubles");
+
+// Vertices per matrix product; keeps a block's measurements and residuals in cache
+static const size_t RECONSTRUCTION_BLOCK = 1024;
+
+vector<ProjectionView> standardViews() {
+    vector<ProjectionView> views(2);
+    views[0].name = "xy";
+    views[0].P << 1, 0, 0,
+                  0, 1, 0;
+    views[1].name = "xz";
+    views[1].P << 1, 0, 0,
+                  0, 0, 1;
+    for (ProjectionView& view : views) {
+        view.offset = Vector2d::Zero();
+    }
+    return views;
+}
+
+bool loadViews(const string& path, vector<ProjectionView>& views) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) {
+        printf("Could not open view file %s\n", path.c_str());
+        return false;
+    }
+    views.clear();
+    char line[512];
+    int lineNumber = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), file)) {
+        ++lineNumber;
+        const char* start = line + strspn(line, " \t\r\n");
+        if (*start == '\0' || *start == '#') continue;
+
+        char name[64];
+        double p[8];
+        if (sscanf(start, "%63s %lf %lf %lf %lf %lf %lf %lf %lf", name, &p[0], &p[1], &p[2], &p[3], &p[4], &p[5],
+                   &p[6], &p[7]) != 9) {
+            printf("Malformed view on line %d of %s\n", lineNumber, path.c_str());
+            ok = false;
+            break;
+        }
+        ProjectionView view;
+        view.name = name;
+        view.P << p[0], p[1], p[2],
+                  p[3], p[4], p[5];
+        view.offset << p[6], p[7];
+        views.push_back(view);
+    }
+    fclose(file);
+    if (ok && views.empty()) {
+        printf("No views in %s\n", path.c_str());
+        ok = false;
+    }
+    return ok;
+}
+
+Reconstructor::Reconstructor(const vector<ProjectionView>& views, double tolerance)
+    : views_(views), tolerance_(tolerance), solvable_(false) {
+    const Index rows = 2 * views_.size();
+    stacked_.resize(rows, 3);
+    offsets_.resize(rows);
+    for (size_t i = 0; i < views_.size(); ++i) {
+        stacked_.block<2, 3>(2 * i, 0) = views_[i].P;
+        offsets_.segment<2>(2 * i) = views_[i].offset;
+    }
+
+    // A^T A is positive definite exactly when the views span all three axes
+    Matrix3d normal = stacked_.transpose() * stacked_;
+    SelfAdjointEigenSolver<Matrix3d> eigen(normal, EigenvaluesOnly);
+    solvable_ = rows >= 3 && eigen.eigenvalues()(0) > 1e-12 * max(1.0, eigen.eigenvalues()(2));
+    if (solvable_) {
+        pseudoInverse_ = normal.ldlt().solve(stacked_.transpose());
+    } else {
+        pseudoInverse_ = MatrixXd::Zero(3, rows);
+    }
+}
+
+void Reconstructor::solve(const double* coords, size_t count, Vertex* vertices, double* residuals) const {
+    const Index rows = stacked_.rows();
+    MatrixXd measured(rows, RECONSTRUCTION_BLOCK);
+    Matrix<double, 3, Dynamic> solved(3, RECONSTRUCTION_BLOCK);
+    for (size_t start = 0; start < count; start += RECONSTRUCTION_BLOCK) {
+        const Index n = min(RECONSTRUCTION_BLOCK, count - start);
+        measured.leftCols(n) = Map<const MatrixXd>(coords + start * rows, rows, n).colwise() - offsets_;
+        solved.leftCols(n).noalias() = pseudoInverse_ * measured.leftCols(n);
+        Map<Matrix<double, 3, Dynamic> >(reinterpret_cast<double*>(vertices + start), 3, n) = solved.leftCols(n);
+        if (!residuals) continue;
+
+        measured.leftCols(n).noalias() -= stacked_ * solved.leftCols(n);
+        for (Index j = 0; j < n; ++j) {
+            double worst = 0;
+            for (Index k = 0; k < rows; k += 2) {
+                worst = max(worst, measured.block<2, 1>(k, j).squaredNorm());
+            }
+            residuals[start + j] = sqrt(worst);
+        }
+    }
+}
+
+void ReconstructionReport::add(const Reconstructor& views, const string& shell, const double* residuals, size_t count) {
+    tolerance = views.tolerance();
+    vertices += count;
+    for (size_t i = 0; i < count; ++i) {
+        maxResidual = max(maxResidual, residuals[i]);
+        if (residuals[i] > tolerance) {
+            flagged.push_back({shell, static_cast<int>(i) + 1, residuals[i]});
+        }
+    }
+}
+
+void printReconstructionReport(const ReconstructionReport& report) {
+    printf("Reconstructed %zu vertices (largest view residual %g)\n", report.vertices, report.maxResidual);
+    if (report.flagged.empty()) return;
+
+    const size_t shown = 10;
+    printf("%zu vertices disagree across views by more than %g:\n", report.flagged.size(), report.tolerance);
+    for (size_t i = 0; i < report.flagged.size() && i < shown; ++i) {
+        const ReconstructionReport::Flag& flag = report.flagged[i];
+        printf("  Vertex %d of the %s polyhedron: residual %g\n", flag.vertex, flag.shell.c_str(), flag.residual);
+    }
+    if (report.flagged.size() > shown) {
+        printf("  ... and %zu more\n", report.flagged.size() - shown);
+    }
+}
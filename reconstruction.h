@@ -0,0 +1,76 @@
+#ifndef RECONSTRUCTION_H
+#define RECONSTRUCTION_H
+
+#include "input.h"
+
+// A calibrated orthographic view: a vertex x appears at (u, v) = P x + offset.
+// Unaligned so views can sit in a std::vector without Eigen's allocator.
+struct ProjectionView {
+    string name;
+    Matrix<double, 2, 3, DontAlign> P;
+    Matrix<double, 2, 1, DontAlign> offset;
+};
+
+// The xy and xz views getInput has always asked for
+vector<ProjectionView> standardViews();
+
+// Reads one view per line, "name p00 p01 p02 p10 p11 p12 u0 v0", with P
+// row by row and the offset last; blank lines and lines starting with #
+// are skipped. Prints the problem and returns false on a malformed file.
+bool loadViews(const string& path, vector<ProjectionView>& views);
+
+// Least-squares vertex positions from any number of views.
+//
+// Stacking the views gives a 2N x 3 system A x = b - c. Its normal
+// equations are factored once per view set into the 3 x 2N pseudo-inverse
+// A+ = (A^T A)^-1 A^T, so a vertex costs one matrix-vector product.
+// Vertices are solved a block at a time as one matrix product, and the
+// residual b - c - A x of each block comes from the same pass. A vertex's
+// residual is the largest distance, in view units, between where it was
+// measured and where its solution projects in any one view. With two
+// views that agree on every shared axis it is zero.
+class Reconstructor {
+public:
+    explicit Reconstructor(const vector<ProjectionView>& views, double tolerance = RECONSTRUCTION_TOLERANCE);
+
+    // False if the views do not pin down all three coordinates
+    bool solvable() const { return solvable_; }
+    size_t numViews() const { return views_.size(); }
+    const ProjectionView& view(size_t i) const { return views_[i]; }
+    double tolerance() const { return tolerance_; }  // Residual beyond which a vertex is flagged
+
+    // coords holds 2 * numViews() values per vertex, view by view in the
+    // order given. Writes count vertices and, if residuals is not null,
+    // count residuals.
+    void solve(const double* coords, size_t count, Vertex* vertices, double* residuals) const;
+
+private:
+    vector<ProjectionView> views_;
+    MatrixXd pseudoInverse_;  // 3 x 2N
+    MatrixXd stacked_;        // A, 2N x 3
+    VectorXd offsets_;        // c, 2N
+    double tolerance_;
+    bool solvable_;
+};
+
+// Vertices whose views disagree by more than the tolerance, across all shells
+struct ReconstructionReport {
+    struct Flag {
+        string shell;
+        int vertex;       // 1-based, as typed
+        double residual;
+    };
+
+    size_t vertices;
+    double maxResidual;
+    double tolerance;
+    vector<Flag> flagged;
+
+    ReconstructionReport() : vertices(0), maxResidual(0), tolerance(RECONSTRUCTION_TOLERANCE) {}
+    // Adds one shell's residuals, flagging those beyond the views' tolerance
+    void add(const Reconstructor& views, const string& shell, const double* residuals, size_t count);
+};
+
+void printReconstructionReport(const ReconstructionReport& report);
+
+#endif
@@ -0,0 +1,165 @@
+#include "scene.h"
+#include "facemesh.h"
+#include "transformations.h"
+
+#include <unordered_set>
+
+using namespace std;
+using namespace Eigen;
+
+Vertex AffineMap::apply(const Vertex& v) const {
+    Vector3d p = linear * Vector3d(v.x, v.y, v.z) + translation;
+    return {p.x(), p.y(), p.z()};
+}
+
+// The linear part is read off by moving the unit vectors with the point function
+template <typename PointFn>
+static AffineMap mapFromPointFunction(PointFn fn) {
+    AffineMap result;
+    Vertex zero = {0, 0, 0};
+    fn(&zero);
+    result.translation = Vector3d(zero.x, zero.y, zero.z);
+    for (int k = 0; k < 3; ++k) {
+        Vertex unit = {k == 0 ? 1.0 : 0.0, k == 1 ? 1.0 : 0.0, k == 2 ? 1.0 : 0.0};
+        fn(&unit);
+        result.linear.col(k) = Vector3d(unit.x, unit.y, unit.z) - result.translation;
+    }
+    return result;
+}
+
+AffineMap rotationMap(double angle, double A, double B, double C) {
+    return mapFromPointFunction([=](Vertex* p) { rotate_point(p, angle, A, B, C); });
+}
+
+AffineMap translationMap(double dx, double dy, double dz) {
+    AffineMap result;
+    result.translation = Vector3d(dx, dy, dz);
+    return result;
+}
+
+AffineMap scaleMap(double sx, double sy, double sz) {
+    AffineMap result;
+    result.linear = Vector3d(sx, sy, sz).asDiagonal();
+    return result;
+}
+
+AffineMap reflectionMap(double A, double B, double C, double D) {
+    return mapFromPointFunction([=](Vertex* p) { reflect_point(p, A, B, C, D); });
+}
+
+AffineMap operator*(const AffineMap& a, const AffineMap& b) {
+    AffineMap result;
+    result.linear = a.linear * b.linear;
+    result.translation = a.linear * b.translation + a.translation;
+    return result;
+}
+
+AffineMap inverseMap(const AffineMap& map) {
+    AffineMap result;
+    result.linear = map.linear.inverse();
+    result.translation = -(result.linear * map.translation);
+    return result;
+}
+
+VolumeIntegrals transformIntegrals(const VolumeIntegrals& sums, const AffineMap& transform) {
+    VolumeIntegrals in = sums;
+    in.symmetrize();
+    const Matrix3d& L = transform.linear;
+    const Vector3d& t = transform.translation;
+    double s = fabs(L.determinant());
+
+    Vector3d m(in.first[0], in.first[1], in.first[2]);
+    Matrix3d C;
+    for (int r = 0; r < 3; ++r) {
+        for (int q = 0; q < 3; ++q) C(r, q) = in.second[r][q];
+    }
+
+    Vector3d Lm = L * m;
+    Vector3d first = s * (Lm + in.volume * t);
+    Matrix3d second = s * (L * C * L.transpose() + Lm * t.transpose() + t * Lm.transpose() + in.volume * t * t.transpose());
+
+    VolumeIntegrals out;
+    out.volume = s * in.volume;
+    for (int r = 0; r < 3; ++r) {
+        out.first[r] = first(r);
+        for (int q = 0; q < 3; ++q) out.second[r][q] = second(r, q);
+    }
+    return out;
+}
+
+// Appends each undirected edge of the shell once, offset into the shared vertex array
+static void appendDrawEdges(const Polyhedron& shell, int offset, vector<int>& edges) {
+    unordered_set<long long> seen;
+    for (const Face& face : shell.faces) {
+        for (const Edge& edge : face.edges) {
+            int a = min(edge.i1, edge.i2), b = max(edge.i1, edge.i2);
+            if (!seen.insert(static_cast<long long>(a) << 32 | static_cast<unsigned>(b)).second) continue;
+            edges.push_back(offset + edge.i1);
+            edges.push_back(offset + edge.i2);
+        }
+    }
+}
+
+int Scene::addMesh(shared_ptr<const Polyhedron> poly) {
+    SceneMesh mesh;
+    mesh.poly = poly;
+    Vertex meshOrigin = {0, 0, 0};
+    accumulateMeshIntegrals(buildFaceMesh(*poly), meshOrigin, mesh.integrals);
+    MassProperties props = massPropertiesFromIntegrals(mesh.integrals, meshOrigin, 1.0);
+    fitOrientedBox(props, poly->vertices);
+    mesh.box = props.box;
+
+    mesh.drawVertices = poly->vertices;
+    appendDrawEdges(*poly, 0, mesh.drawEdges);
+    mesh.outerEdges = mesh.drawEdges.size() / 2;
+    for (const Polyhedron& hole : poly->sub_polyhedrons) {
+        int offset = static_cast<int>(mesh.drawVertices.size());
+        mesh.drawVertices.insert(mesh.drawVertices.end(), hole.vertices.begin(), hole.vertices.end());
+        appendDrawEdges(hole, offset, mesh.drawEdges);
+    }
+
+    meshes_.push_back(std::move(mesh));
+    return static_cast<int>(meshes_.size()) - 1;
+}
+
+void Scene::addInstance(int mesh, const AffineMap& transform) {
+    SceneInstance instance;
+    instance.mesh = mesh;
+    instance.transform = transform;
+    instances_.push_back(instance);
+}
+
+MassProperties Scene::massProperties(const Vertex& origin, double density) const {
+    // Every instance is moved into world coordinates about `origin`, so the
+    // sums are taken directly in the frame the caller asked for
+    AffineMap toOrigin = translationMap(-origin.x, -origin.y, -origin.z);
+    VolumeIntegrals total;
+    vector<Vertex> corners;
+    corners.reserve(8 * instances_.size());
+
+    for (const SceneInstance& instance : instances_) {
+        const SceneMesh& mesh = meshes_[instance.mesh];
+        VolumeIntegrals part = transformIntegrals(mesh.integrals, toOrigin * instance.transform);
+        total.volume += part.volume;
+        for (int r = 0; r < 3; ++r) {
+            total.first[r] += part.first[r];
+            for (int q = 0; q < 3; ++q) total.second[r][q] += part.second[r][q];
+        }
+
+        const OrientedBox& box = mesh.box;
+        for (int corner = 0; corner < 8; ++corner) {
+            Vertex p = box.center;
+            for (int k = 0; k < 3; ++k) {
+                double sign = (corner >> k) & 1 ? 1.0 : -1.0;
+                p.x += sign * box.halfExtents[k] * box.axes[k].x;
+                p.y += sign * box.halfExtents[k] * box.axes[k].y;
+                p.z += sign * box.halfExtents[k] * box.axes[k].z;
+            }
+            corners.push_back(instance.transform.apply(p));
+        }
+    }
+
+    MassProperties props = massPropertiesFromIntegrals(total, origin, density);
+    fitOrientedBox(props, corners);
+    return props;
+}
@@ -0,0 +1,70 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "geometry.h"
+
+#include <memory>
+
+// x' = linear * x + translation
+struct AffineMap {
+    Matrix3d linear;
+    Vector3d translation;
+
+    AffineMap() : linear(Matrix3d::Identity()), translation(Vector3d::Zero()) {}
+    Vertex apply(const Vertex& v) const;
+};
+
+// Same conventions as rotate_point, translate_point, scale_point and reflect_point
+AffineMap rotationMap(double angle, double A, double B, double C);
+AffineMap translationMap(double dx, double dy, double dz);
+AffineMap scaleMap(double sx, double sy, double sz);
+AffineMap reflectionMap(double A, double B, double C, double D);
+AffineMap operator*(const AffineMap& a, const AffineMap& b);  // a applied after b
+AffineMap inverseMap(const AffineMap& map);
+
+// Integrals of the mapped solid, from the integrals of the original:
+// V' = s V, m' = s (L m + V t), C' = s (L C L^T + L m t^T + t m^T L^T + V t t^T)
+// with s = |det L|, so a reflected instance still has positive volume
+VolumeIntegrals transformIntegrals(const VolumeIntegrals& sums, const AffineMap& transform);
+
+// A mesh shared by any number of instances. Everything here is computed once,
+// in the mesh's own frame, when the mesh is added.
+struct SceneMesh {
+    shared_ptr<const Polyhedron> poly;
+    VolumeIntegrals integrals;   // About the mesh's origin, holes included
+    OrientedBox box;
+    // Outer and hole vertices in one array and each undirected edge once, for the viewer
+    vector<Vertex> drawVertices;
+    vector<int> drawEdges;       // Pairs of indices into drawVertices
+    size_t outerEdges;           // Edges [0, outerEdges) belong to the outer shell
+};
+
+struct SceneInstance {
+    int mesh;
+    AffineMap transform;
+};
+
+// Many posed copies of a few meshes. Instances only hold a mesh index and a
+// transform, so 10,000 copies of a bracket cost 10,000 transforms, not
+// 10,000 polyhedrons.
+class Scene {
+public:
+    int addMesh(shared_ptr<const Polyhedron> poly);
+    void addInstance(int mesh, const AffineMap& transform);
+
+    size_t numMeshes() const { return meshes_.size(); }
+    const SceneMesh& mesh(int i) const { return meshes_[i]; }
+    const vector<SceneInstance>& instances() const { return instances_; }
+
+    // Assembly properties from the per-mesh integrals; no vertex is touched.
+    // The box encloses the transformed box of every instance, so it is
+    // conservative. Surface area does not follow from the integrals under a
+    // general affine map and is not included.
+    MassProperties massProperties(const Vertex& origin, double density) const;
+
+private:
+    vector<SceneMesh> meshes_;
+    vector<SceneInstance> instances_;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "scheduler.h"
+
+using namespace std;
+
+TaskScheduler::TaskScheduler(unsigned numWorkers) : stopping_(false) {
+    if (numWorkers == 0) numWorkers = thread::hardware_concurrency();
+    if (numWorkers == 0) numWorkers = 2;
+    for (unsigned i = 0; i < numWorkers; ++i) {
+        workers_.push_back(thread(&TaskScheduler::workerLoop, this));
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    available_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+void TaskScheduler::enqueue(function<void()> job) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    available_.notify_one();
+}
+
+void TaskScheduler::workerLoop() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> lock(mutex_);
+            available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job(); // Exceptions are captured in the task's future by packaged_task
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Thrown by TaskState::checkCancelled to unwind a task that was cancelled
+struct TaskCancelled : public std::exception {
+    const char* what() const noexcept override { return "task cancelled"; }
+};
+
+// Shared between a running task and whoever holds its handle
+struct TaskState {
+    std::string name;
+    std::atomic<int> progressPermille; // 0..1000
+    std::atomic<bool> cancelRequested;
+
+    explicit TaskState(const std::string& taskName) : name(taskName), progressPermille(0), cancelRequested(false) {}
+
+    void setProgress(double fraction) { progressPermille = static_cast<int>(fraction * 1000.0); }
+    double progress() const { return progressPermille / 1000.0; }
+    // Called by tasks at safe points
+    void checkCancelled() const { if (cancelRequested) throw TaskCancelled(); }
+};
+
+// Handle to a submitted task: poll it, wait for it or cancel it
+template <typename T>
+struct Task {
+    std::shared_ptr<TaskState> state;
+    std::shared_future<T> result;
+
+    bool ready() const {
+        return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    void cancel() { state->cancelRequested = true; }
+    // Blocks until done; rethrows TaskCancelled or the task's own exception
+    T get() const { return result.get(); }
+};
+
+// Fixed pool of worker threads running submitted tasks in FIFO order
+class TaskScheduler {
+public:
+    explicit TaskScheduler(unsigned numWorkers = 0);
+    ~TaskScheduler(); // Cancels nothing; waits for queued tasks to finish
+
+    template <typename T>
+    Task<T> submit(const std::string& name, std::function<T(TaskState&)> fn) {
+        Task<T> task;
+        task.state = std::make_shared<TaskState>(name);
+        std::shared_ptr<std::packaged_task<T()> > job = std::make_shared<std::packaged_task<T()> >(
+            std::bind(fn, std::ref(*task.state)));
+        std::shared_ptr<TaskState> state = task.state;
+        task.result = job->get_future().share();
+        enqueue([job, state]() {
+            (*job)();
+            state->setProgress(1.0);
+        });
+        return task;
+    }
+
+    unsigned numWorkers() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    void enqueue(std::function<void()> job);
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()> > jobs_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    bool stopping_;
+};
+
+#endif
@@ -0,0 +1,539 @@
+#include "service.h"
+#include "cache.h"
+#include "facemesh.h"
+#include "geometry.h"
+#include "halfedge.h"
+#include "json.h"
+#include "projections.h"
+#include "scheduler.h"
+#include "transformations.h"
+#include "validity.h"
+#include "weld.h"
+
+#include <cerrno>
+#include <chrono>
+#include <pthread.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Reader/writer lock (C++11 has no shared_mutex)
+class RwLock {
+public:
+    RwLock() { pthread_rwlock_init(&lock_, nullptr); }
+    ~RwLock() { pthread_rwlock_destroy(&lock_); }
+    void lockShared() { pthread_rwlock_rdlock(&lock_); }
+    void lockExclusive() { pthread_rwlock_wrlock(&lock_); }
+    void unlock() { pthread_rwlock_unlock(&lock_); }
+
+private:
+    RwLock(const RwLock&);
+    RwLock& operator=(const RwLock&);
+    pthread_rwlock_t lock_;
+};
+
+// Scoped read or write hold on an RwLock
+class RwGuard {
+public:
+    RwGuard(RwLock& lock, bool exclusive) : lock_(lock) {
+        if (exclusive) lock_.lockExclusive();
+        else lock_.lockShared();
+    }
+    ~RwGuard() { lock_.unlock(); }
+
+private:
+    RwLock& lock_;
+};
+
+struct ModelEntry {
+    RwLock lock;
+    Polyhedron poly;
+};
+
+// Name -> model. The registry mutex only guards the map itself; work on a
+// model happens under that model's own lock, and a model that is unloaded
+// or replaced stays alive until its last request finishes.
+struct ModelRegistry {
+    mutex mutex_;
+    map<string, shared_ptr<ModelEntry> > models;
+    ResultCache* cache;
+    double weldTolerance;    // From --weld; applied to every loaded model
+    atomic<bool> stopping;
+    string socketPath;
+    vector<int> connections; // Open socket connections, guarded by mutex_; each is removed as it closes
+
+    ModelRegistry() : cache(nullptr), weldTolerance(WELD_TOLERANCE), stopping(false) {}
+
+    shared_ptr<ModelEntry> find(const string& name) {
+        lock_guard<mutex> lock(mutex_);
+        auto it = models.find(name);
+        return it == models.end() ? shared_ptr<ModelEntry>() : it->second;
+    }
+};
+
+// Thrown for malformed requests; becomes an error response
+struct RequestError {
+    string message;
+    explicit RequestError(const string& text) : message(text) {}
+};
+
+static const JsonValue& requireMember(const JsonValue& request, const string& key) {
+    const JsonValue* value = request.get(key);
+    if (!value) throw RequestError("missing \"" + key + "\"");
+    return *value;
+}
+
+static double requireNumber(const JsonValue& request, const string& key) {
+    const JsonValue& value = requireMember(request, key);
+    if (!value.isNumber()) throw RequestError("\"" + key + "\" must be a number");
+    return value.number;
+}
+
+static vector<double> requireNumbers(const JsonValue& request, const string& key, size_t count) {
+    const JsonValue& value = requireMember(request, key);
+    if (!value.isArray() || value.items.size() != count) {
+        throw RequestError("\"" + key + "\" must be an array of " + to_string(count) + " numbers");
+    }
+    vector<double> numbers;
+    for (const auto& item : value.items) {
+        if (!item.isNumber()) throw RequestError("\"" + key + "\" must contain numbers");
+        numbers.push_back(item.number);
+    }
+    return numbers;
+}
+
+// Builds one shell (and its holes) from {"vertices":..., "faces":..., "holes":...}
+static void buildShell(const JsonValue& shell, Polyhedron& poly) {
+    const JsonValue& vertices = requireMember(shell, "vertices");
+    const JsonValue& faces = requireMember(shell, "faces");
+    if (!vertices.isArray() || !faces.isArray()) throw RequestError("\"vertices\" and \"faces\" must be arrays");
+
+    for (const auto& item : vertices.items) {
+        if (!item.isArray() || item.items.size() != 3 || !item.items[0].isNumber() ||
+            !item.items[1].isNumber() || !item.items[2].isNumber()) {
+            throw RequestError("each vertex must be [x, y, z]");
+        }
+        poly.vertices.push_back({item.items[0].number, item.items[1].number, item.items[2].number});
+    }
+
+    int numVertices = static_cast<int>(poly.vertices.size());
+    for (const auto& item : faces.items) {
+        if (!item.isArray() || item.items.size() < 3) throw RequestError("each face must list at least 3 vertex indices");
+        size_t n = item.items.size();
+        vector<int> loop(n);
+        for (size_t j = 0; j < n; ++j) {
+            const JsonValue& index = item.items[j];
+            if (!index.isNumber() || index.number != floor(index.number)) {
+                throw RequestError("face vertex indices must be integers");
+            }
+            if (index.number < 0 || index.number >= numVertices) throw RequestError("face vertex index out of range");
+            loop[j] = static_cast<int>(index.number);
+        }
+        Face face;
+        for (size_t j = 0; j < n; ++j) {
+            Edge edge;
+            edge.i1 = loop[j];
+            edge.i2 = loop[(j + 1) % n];
+            edge.v1 = poly.vertices[edge.i1];
+            edge.v2 = poly.vertices[edge.i2];
+            edge.length = computeDistance(edge.v1, edge.v2);
+            face.edges.push_back(edge);
+        }
+        face.num_edges = static_cast<int>(n);
+        poly.faces.push_back(face);
+    }
+
+    const JsonValue* holes = shell.get("holes");
+    if (holes) {
+        if (!holes->isArray()) throw RequestError("\"holes\" must be an array");
+        for (const auto& hole : holes->items) {
+            poly.sub_polyhedrons.push_back(Polyhedron());
+            buildShell(hole, poly.sub_polyhedrons.back());
+        }
+    }
+}
+
+static string vertexJson(const Vertex& v) {
+    ostringstream out;
+    out.precision(17);
+    out << "[" << v.x << "," << v.y << "," << v.z << "]";
+    return out.str();
+}
+
+static void projectShellJson(const Polyhedron& poly, const vector<double>& plane, ostringstream& out) {
+    vector<Point2D> points = projectVerticesOntoPlane(poly.vertices, plane[0], plane[1], plane[2], plane[3]);
+    out << "{\"points\":[";
+    for (size_t i = 0; i < points.size(); ++i) {
+        out << (i ? "," : "") << "[" << points[i].u << "," << points[i].v << "]";
+    }
+    out << "],\"edges\":[";
+    bool first = true;
+    for (const auto& face : poly.faces) {
+        for (const auto& edge : face.edges) {
+            out << (first ? "" : ",") << "[" << edge.i1 << "," << edge.i2 << "]";
+            first = false;
+        }
+    }
+    out << "],\"holes\":[";
+    for (size_t i = 0; i < poly.sub_polyhedrons.size(); ++i) {
+        if (i) out << ",";
+        projectShellJson(poly.sub_polyhedrons[i], plane, out);
+    }
+    out << "]}";
+}
+
+// Runs one request and returns the body of the response (without braces)
+static string dispatch(ModelRegistry& registry, const JsonValue& request) {
+    const JsonValue& opValue = requireMember(request, "op");
+    if (!opValue.isString()) throw RequestError("\"op\" must be a string");
+    const string& op = opValue.text;
+
+    if (op == "list") {
+        lock_guard<mutex> lock(registry.mutex_);
+        string body = "\"models\":[";
+        bool first = true;
+        for (const auto& entry : registry.models) {
+            body += (first ? "" : ",") + jsonString(entry.first);
+            first = false;
+        }
+        return body + "]";
+    }
+    if (op == "shutdown") {
+        registry.stopping = true;
+        return "\"stopping\":true";
+    }
+
+    if (op != "load" && op != "unload" && op != "validate" && op != "mass" && op != "project" && op != "transform") {
+        throw RequestError("unknown op " + op);
+    }
+
+    const JsonValue& nameValue = requireMember(request, "model");
+    if (!nameValue.isString()) throw RequestError("\"model\" must be a string");
+    const string& name = nameValue.text;
+
+    if (op == "load") {
+        shared_ptr<ModelEntry> entry = make_shared<ModelEntry>();
+        buildShell(request, entry->poly);
+        WeldReport weld = weldPolyhedron(entry->poly, registry.weldTolerance);
+        OrientationReport orientation = orientPolyhedron(entry->poly);
+        {
+            lock_guard<mutex> lock(registry.mutex_);
+            registry.models[name] = entry;
+        }
+        ostringstream out;
+        out << "\"vertices\":" << weld.verticesAfter << ",\"merged\":" << weld.verticesBefore - weld.verticesAfter
+            << ",\"shells\":" << orientation.shells << ",\"flipped\":" << orientation.facesFlipped;
+        return out.str();
+    }
+    if (op == "unload") {
+        lock_guard<mutex> lock(registry.mutex_);
+        if (!registry.models.erase(name)) throw RequestError("unknown model " + name);
+        return "\"unloaded\":true";
+    }
+
+    shared_ptr<ModelEntry> entry = registry.find(name);
+    if (!entry) throw RequestError("unknown model " + name);
+
+    if (op == "validate") {
+        RwGuard guard(entry->lock, false);
+        AnalysisRecord record = AnalysisRecord();
+        record.key = hashPolyhedron(entry->poly, origin, density);
+        bool valid;
+        if (registry.cache && registry.cache->lookup(record.key, record) && (record.flags & CACHE_VALIDATED)) {
+            valid = (record.flags & CACHE_VALID) != 0;
+        } else {
+            valid = validateInput(entry->poly);
+            record.flags = CACHE_VALIDATED | (valid ? CACHE_VALID : 0u);
+            if (registry.cache) registry.cache->store(record);
+        }
+        return string("\"valid\":") + (valid ? "true" : "false");
+    }
+
+    if (op == "mass") {
+        Vertex massOrigin = origin;
+        double massDensity = density;
+        if (request.get("origin")) {
+            vector<double> o = requireNumbers(request, "origin", 3);
+            massOrigin = {o[0], o[1], o[2]};
+        }
+        if (request.get("density")) massDensity = requireNumber(request, "density");
+
+        RwGuard guard(entry->lock, false);
+        AnalysisRecord record = analysePolyhedron(entry->poly, massOrigin, massDensity, registry.cache,
+                                                  CACHE_SURFACE_AREA | CACHE_VOLUME | CACHE_CENTER_OF_MASS | CACHE_INERTIA);
+        ostringstream out;
+        out.precision(17);
+        const InertiaTensor& I = record.inertia;
+        out << "\"surfaceArea\":" << record.surfaceArea << ",\"volume\":" << record.volume
+            << ",\"centerOfMass\":" << vertexJson(record.centerOfMass)
+            << ",\"inertia\":{\"Ixx\":" << I.Ixx << ",\"Iyy\":" << I.Iyy << ",\"Izz\":" << I.Izz
+            << ",\"Ixy\":" << I.Ixy << ",\"Ixz\":" << I.Ixz << ",\"Iyz\":" << I.Iyz << "}";
+        return out.str();
+    }
+
+    if (op == "project") {
+        vector<double> plane = requireNumbers(request, "plane", 4);
+        if (plane[0] == 0 && plane[1] == 0 && plane[2] == 0) throw RequestError("the plane normal cannot be zero");
+        RwGuard guard(entry->lock, false);
+        ostringstream out;
+        out.precision(17);
+        out << "\"projection\":";
+        projectShellJson(entry->poly, plane, out);
+        out << ",\"projectedArea\":" << meshProjectedArea(buildFaceMesh(entry->poly, false), plane[0], plane[1], plane[2]);
+        return out.str();
+    }
+
+    if (op == "transform") {
+        const JsonValue& typeValue = requireMember(request, "type");
+        if (!typeValue.isString()) throw RequestError("\"type\" must be a string");
+        const string& type = typeValue.text;
+
+        RwGuard guard(entry->lock, true);
+        Polyhedron& poly = entry->poly;
+        if (type == "rotate") {
+            double angle = requireNumber(request, "angle");
+            vector<double> axis = requireNumbers(request, "axis", 3);
+            if (axis[0] == 0 && axis[1] == 0 && axis[2] == 0) throw RequestError("the rotation axis cannot be zero");
+            rotate_polyhedron(poly, angle, axis[0], axis[1], axis[2]);
+        } else if (type == "translate") {
+            vector<double> offset = requireNumbers(request, "offset", 3);
+            translate_polyhedron(poly, offset[0], offset[1], offset[2]);
+        } else if (type == "scale") {
+            vector<double> factors = requireNumbers(request, "factors", 3);
+            scale_polyhedron(poly, factors[0], factors[1], factors[2]);
+        } else if (type == "reflect") {
+            vector<double> plane = requireNumbers(request, "plane", 4);
+            if (plane[0] == 0 && plane[1] == 0 && plane[2] == 0) throw RequestError("the plane normal cannot be zero");
+            reflect_polyhedron(poly, plane[0], plane[1], plane[2], plane[3]);
+        } else {
+            throw RequestError("unknown transform type " + type);
+        }
+        update_edges(poly);
+        // Mirroring turns every face inside out; restore outward orientation
+        if (type == "reflect" || type == "scale") orientPolyhedron(poly);
+        return "\"transformed\":true";
+    }
+
+    throw RequestError("unknown op " + op); // Not reached; ops are checked above
+}
+
+// Parses and runs one request line, always producing one response line
+static string handleLine(ModelRegistry& registry, const string& line) {
+    JsonValue request;
+    string error;
+    string id = "null";
+    if (!parseJson(line, request, error)) {
+        return "{\"id\":null,\"ok\":false,\"error\":" + jsonString(error) + "}";
+    }
+    const JsonValue* idValue = request.get("id");
+    if (idValue) {
+        if (idValue->isString()) id = jsonString(idValue->text);
+        else if (idValue->isNumber()) {
+            ostringstream out;
+            out.precision(17);
+            out << idValue->number;
+            id = out.str();
+        }
+    }
+
+    try {
+        if (!request.isObject()) throw RequestError("request must be an object");
+        string body = dispatch(registry, request);
+        return "{\"id\":" + id + ",\"ok\":true," + body + "}";
+    } catch (const RequestError& e) {
+        return "{\"id\":" + id + ",\"ok\":false,\"error\":" + jsonString(e.message) + "}";
+    } catch (const exception& e) {
+        return "{\"id\":" + id + ",\"ok\":false,\"error\":" + jsonString(e.what()) + "}";
+    }
+}
+
+// Only a line that mentions it is parsed here, so other requests are still
+// parsed on the scheduler
+static bool isShutdownRequest(const string& line) {
+    if (line.find("shutdown") == string::npos) return false;
+    JsonValue request;
+    string error;
+    if (!parseJson(line, request, error)) return false;
+    const JsonValue* op = request.get("op");
+    return op && op->isString() && op->text == "shutdown";
+}
+
+// stdin/stdout mode: every request runs on the scheduler, so a slow mass
+// query does not hold up the lines behind it; responses carry the id. A
+// shutdown is answered on the reading thread and nothing after it is read.
+static int serveStdin(ModelRegistry& registry) {
+    // Keep stdout for the protocol only; the validators' printf output goes to stderr
+    fflush(stdout);
+    int protocolFd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    FILE* out = fdopen(protocolFd, "w");
+    if (!out) return 1;
+
+    mutex outMutex;
+    {
+        TaskScheduler scheduler;
+        string line;
+        while (!registry.stopping && getline(cin, line)) {
+            if (line.empty()) continue;
+            if (isShutdownRequest(line)) {
+                string response = handleLine(registry, line);
+                lock_guard<mutex> lock(outMutex);
+                fprintf(out, "%s\n", response.c_str());
+                fflush(out);
+                break;
+            }
+            scheduler.submit<int>("request", [&registry, &outMutex, out, line](TaskState&) {
+                string response = handleLine(registry, line);
+                lock_guard<mutex> lock(outMutex);
+                fprintf(out, "%s\n", response.c_str());
+                fflush(out);
+                return 0;
+            });
+        }
+    } // Scheduler destructor waits for outstanding requests
+    fclose(out);
+    return 0;
+}
+
+// Connects once to our own socket so a blocked accept() returns and sees the stop flag
+static void wakeListener(const string& socketPath) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    close(fd);
+}
+
+// accept() failures other than EINTR wait before retrying, twice as long each
+// time, and the service stops after this many in a row
+static const int ACCEPT_BACKOFF_MS = 10;
+static const int ACCEPT_BACKOFF_MAX_MS = 1000;
+static const int ACCEPT_MAX_FAILURES = 50;
+
+static void serveRequests(ModelRegistry& registry, int fd) {
+    string pending;
+    char buffer[65536];
+    ssize_t n;
+    while (!registry.stopping && (n = read(fd, buffer, sizeof(buffer))) > 0) {
+        pending.append(buffer, n);
+        size_t newline;
+        while ((newline = pending.find('\n')) != string::npos) {
+            string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (line.empty()) continue;
+            string response = handleLine(registry, line) + "\n";
+            size_t written = 0;
+            while (written < response.size()) {
+                ssize_t w = write(fd, response.data() + written, response.size() - written);
+                if (w <= 0) break;
+                written += w;
+            }
+            if (registry.stopping) {
+                wakeListener(registry.socketPath);
+                return;
+            }
+        }
+    }
+}
+
+// Serves one client until it disconnects, then closes its socket and flags
+// the worker for the accept loop to join
+static void serveConnection(ModelRegistry& registry, int fd, shared_ptr<atomic<bool> > done) {
+    serveRequests(registry, fd);
+    {
+        lock_guard<mutex> lock(registry.mutex_);
+        registry.connections.erase(find(registry.connections.begin(), registry.connections.end(), fd));
+        close(fd);
+    }
+    *done = true;
+}
+
+// Joins the workers whose clients have gone
+static void reapWorkers(vector<pair<thread, shared_ptr<atomic<bool> > > >& workers) {
+    for (size_t i = 0; i < workers.size();) {
+        if (*workers[i].second) {
+            workers[i].first.join();
+            workers[i] = move(workers.back());
+            workers.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+static int serveSocket(ModelRegistry& registry, const string& socketPath) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return 1;
+    }
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        printf("Socket path is too long: %s\n", socketPath.c_str());
+        close(listener);
+        return 1;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        perror("bind/listen");
+        close(listener);
+        return 1;
+    }
+    printf("Serving on %s\n", socketPath.c_str());
+    fflush(stdout);
+
+    vector<pair<thread, shared_ptr<atomic<bool> > > > workers;
+    int failures = 0;
+    int status = 0;
+    while (!registry.stopping) {
+        int fd = accept(listener, nullptr, nullptr);
+        reapWorkers(workers);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            // Out of descriptors or memory, most likely; finished clients may free some
+            perror("accept");
+            if (++failures >= ACCEPT_MAX_FAILURES) {
+                status = 1;
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(min(ACCEPT_BACKOFF_MS << min(failures - 1, 16), ACCEPT_BACKOFF_MAX_MS)));
+            continue;
+        }
+        failures = 0;
+        if (registry.stopping) {
+            close(fd);
+            break;
+        }
+        lock_guard<mutex> lock(registry.mutex_);
+        registry.connections.push_back(fd);
+        shared_ptr<atomic<bool> > done = make_shared<atomic<bool> >(false);
+        workers.push_back(make_pair(thread(serveConnection, ref(registry), fd, done), done));
+    }
+    close(listener);
+    unlink(socketPath.c_str());
+
+    // Unblock connections still waiting in read() and wait for them to finish
+    {
+        lock_guard<mutex> lock(registry.mutex_);
+        for (int fd : registry.connections) shutdown(fd, SHUT_RDWR);
+    }
+    for (auto& worker : workers) worker.first.join();
+    return status;
+}
+
+int runService(const string& socketPath, ResultCache* cache, double weldTolerance) {
+    ModelRegistry registry;
+    registry.cache = cache;
+    registry.weldTolerance = weldTolerance;
+    registry.socketPath = socketPath;
+    return socketPath.empty() ? serveStdin(registry) : serveSocket(registry, socketPath);
+}
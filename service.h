@@ -0,0 +1,30 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include "input.h"
+
+class ResultCache;
+
+// Long-running mode that keeps loaded polyhedra resident and answers JSON
+// requests, one per line. With an empty socketPath requests come from stdin
+// and responses go to stdout (diagnostics are moved to stderr); otherwise it
+// listens on a Unix domain socket and serves each connection on its own
+// thread. Requests on one model share a read lock, transforms take a write
+// lock, and different models never block each other. Requests are handled
+// concurrently, so pipelined requests may complete out of order: wait for a
+// response (matched by "id") before sending a request that depends on it.
+//
+// Requests (every one may carry an "id" that is echoed back):
+//   {"op":"load","model":"m","vertices":[[x,y,z],...],"faces":[[0,1,2],...],"holes":[{...}]}
+//   {"op":"validate","model":"m"}
+//   {"op":"transform","model":"m","type":"rotate","angle":deg,"axis":[A,B,C]}
+//       type "translate" takes "offset":[dx,dy,dz], "scale" takes "factors":[sx,sy,sz],
+//       "reflect" takes "plane":[A,B,C,D]
+//   {"op":"mass","model":"m","density":1,"origin":[0,0,0]}
+//   {"op":"project","model":"m","plane":[A,B,C,D]}
+//   {"op":"unload","model":"m"}, {"op":"list"}, {"op":"shutdown"}
+//
+// Loaded models are welded with weldTolerance, as --weld sets for the other modes.
+int runService(const string& socketPath, ResultCache* cache, double weldTolerance = WELD_TOLERANCE);
+
+#endif
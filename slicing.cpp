@@ -0,0 +1,229 @@
+#include "slicing.h"
+
+#include <cstdint>
+#include <thread>
+
+using namespace std;
+
+// A fan triangle with global vertex ids, so crossing points on a shared mesh
+// edge get the same key from both triangles that own the edge
+struct SliceTriangle {
+    int v[3];
+    double minHeight, maxHeight;
+};
+
+struct SliceSegment {
+    uint64_t startEdge, endEdge;
+    Point2D start;
+};
+
+// Appends every shell's vertices and fan triangles, offsetting vertex ids per shell
+static void collectTriangles(const Polyhedron& poly, vector<Vertex>& vertices, vector<SliceTriangle>& triangles) {
+    int base = static_cast<int>(vertices.size());
+    vertices.insert(vertices.end(), poly.vertices.begin(), poly.vertices.end());
+    for (const auto& face : poly.faces) {
+        for (size_t j = 1; j + 1 < face.edges.size(); ++j) {
+            SliceTriangle t;
+            t.v[0] = base + face.edges[0].i1;
+            t.v[1] = base + face.edges[j].i1;
+            t.v[2] = base + face.edges[j + 1].i1;
+            triangles.push_back(t);
+        }
+    }
+    for (const auto& sub : poly.sub_polyhedrons) {
+        collectTriangles(sub, vertices, triangles);
+    }
+}
+
+static uint64_t edgeKey(int a, int b) {
+    if (a > b) swap(a, b);
+    return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+}
+
+// Open-addressing map from a crossing's edge key to the segment starting there.
+// Allocation-free once warmed up, since it is reused for every plane.
+struct EdgeTable {
+    vector<uint64_t> keys; // 0 = empty; edge keys are never 0 because a != b
+    vector<int> values;
+    size_t mask;
+
+    void reset(size_t count) {
+        size_t capacity = 16;
+        while (capacity < count * 2) capacity *= 2;
+        if (keys.size() != capacity) {
+            keys.assign(capacity, 0);
+            values.resize(capacity);
+        } else {
+            fill(keys.begin(), keys.end(), 0);
+        }
+        mask = capacity - 1;
+    }
+    static size_t slot(uint64_t key) { return (key * 0x9E3779B97F4A7C15ULL) >> 20; }
+    void insert(uint64_t key, int value) {
+        size_t i = slot(key) & mask;
+        while (keys[i] != 0 && keys[i] != key) i = (i + 1) & mask;
+        keys[i] = key;
+        values[i] = value;
+    }
+    int find(uint64_t key) const {
+        for (size_t i = slot(key) & mask; keys[i] != 0; i = (i + 1) & mask) {
+            if (keys[i] == key) return values[i];
+        }
+        return -1;
+    }
+};
+
+// Chains segments into loops by matching each segment's end edge with the next one's start edge
+static void linkContours(const vector<SliceSegment>& segments, EdgeTable& byStart, Slice& slice) {
+    byStart.reset(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        byStart.insert(segments[i].startEdge, static_cast<int>(i));
+    }
+
+    vector<char> used(segments.size(), 0);
+    slice.area = 0.0;
+    slice.openChains = 0;
+    for (size_t first = 0; first < segments.size(); ++first) {
+        if (used[first]) continue;
+        SliceContour contour;
+        int current = static_cast<int>(first);
+        bool closed = false;
+        while (true) {
+            used[current] = 1;
+            contour.points.push_back(segments[current].start);
+            int following = byStart.find(segments[current].endEdge);
+            if (following < 0) break;
+            if (following == static_cast<int>(first)) {
+                closed = true;
+                break;
+            }
+            if (used[following]) break;
+            current = following;
+        }
+        if (!closed) {
+            slice.openChains++;
+            continue;
+        }
+
+        // Shoelace formula
+        double twiceArea = 0.0;
+        for (size_t i = 0; i < contour.points.size(); ++i) {
+            const Point2D& p = contour.points[i];
+            const Point2D& q = contour.points[(i + 1) % contour.points.size()];
+            twiceArea += p.u * q.v - q.u * p.v;
+        }
+        contour.area = twiceArea / 2.0;
+        slice.area += contour.area;
+        slice.contours.push_back(contour);
+    }
+}
+
+vector<Slice> slicePolyhedron(const Polyhedron& poly, double A, double B, double C,
+                              const vector<double>& offsets, unsigned numThreads) {
+    vector<Slice> slices(offsets.size());
+    double normLength = sqrt(A * A + B * B + C * C);
+    if (offsets.empty() || normLength == 0) return slices;
+
+    Vector3d normal(A / normLength, B / normLength, C / normLength);
+    Vector3d axisU, axisV;
+    planeBasis(A, B, C, axisU, axisV);
+
+    vector<Vertex> vertices;
+    vector<SliceTriangle> triangles;
+    collectTriangles(poly, vertices, triangles);
+
+    // Height of every vertex along the unit normal, and each triangle's span
+    vector<double> height(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        height[i] = normal.x() * vertices[i].x + normal.y() * vertices[i].y + normal.z() * vertices[i].z;
+    }
+    for (auto& t : triangles) {
+        t.minHeight = min(height[t.v[0]], min(height[t.v[1]], height[t.v[2]]));
+        t.maxHeight = max(height[t.v[0]], max(height[t.v[1]], height[t.v[2]]));
+    }
+    sort(triangles.begin(), triangles.end(), [](const SliceTriangle& a, const SliceTriangle& b) {
+        return a.minHeight < b.minHeight;
+    });
+
+    // Planes are swept in increasing height; remember where each result goes
+    vector<size_t> order(offsets.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+
+    auto sweep = [&](size_t beginPlane, size_t endPlane) {
+        vector<int> active;
+        vector<SliceSegment> segments;
+        EdgeTable byStart;
+        size_t nextTriangle = 0;
+
+        for (size_t k = beginPlane; k < endPlane; ++k) {
+            size_t index = order[k];
+            double h = offsets[index] / normLength;
+
+            // Admit triangles starting at or below this plane, retire those that ended below it
+            while (nextTriangle < triangles.size() && triangles[nextTriangle].minHeight <= h) {
+                active.push_back(static_cast<int>(nextTriangle++));
+            }
+            size_t kept = 0;
+            for (int t : active) {
+                if (triangles[t].maxHeight >= h) active[kept++] = t;
+            }
+            active.resize(kept);
+
+            segments.clear();
+            for (int t : active) {
+                const SliceTriangle& tri = triangles[t];
+                // A vertex exactly on the plane counts as above it, so every
+                // crossing lies strictly inside one mesh edge
+                bool above[3];
+                int numAbove = 0;
+                for (int j = 0; j < 3; ++j) {
+                    above[j] = height[tri.v[j]] >= h;
+                    numAbove += above[j];
+                }
+                if (numAbove == 0 || numAbove == 3) continue;
+
+                // Walking the triangle in winding order, the segment runs from the
+                // edge that goes down through the plane to the edge that comes back
+                // up; for outward faces that traces material counter-clockwise
+                SliceSegment segment;
+                for (int j = 0; j < 3; ++j) {
+                    int a = tri.v[j], b = tri.v[(j + 1) % 3];
+                    if (above[j] == above[(j + 1) % 3]) continue;
+                    double s = (h - height[a]) / (height[b] - height[a]);
+                    const Vertex& p = vertices[a];
+                    const Vertex& q = vertices[b];
+                    Vector3d point(p.x + s * (q.x - p.x), p.y + s * (q.y - p.y), p.z + s * (q.z - p.z));
+                    Point2D planar = {point.dot(axisU), point.dot(axisV)};
+                    if (above[j]) {
+                        segment.startEdge = edgeKey(a, b);
+                        segment.start = planar;
+                    } else {
+                        segment.endEdge = edgeKey(a, b); // Its point starts the next segment
+                    }
+                }
+                segments.push_back(segment);
+            }
+
+            Slice& slice = slices[index];
+            slice.offset = offsets[index];
+            linkContours(segments, byStart, slice);
+        }
+    };
+
+    if (numThreads == 0) numThreads = thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 1;
+    numThreads = static_cast<unsigned>(min<size_t>(numThreads, offsets.size()));
+
+    // Contiguous plane ranges keep each thread's active list incremental
+    vector<thread> workers;
+    size_t perThread = (offsets.size() + numThreads - 1) / numThreads;
+    for (unsigned w = 0; w < numThreads; ++w) {
+        size_t begin = w * perThread;
+        size_t end = min(offsets.size(), begin + perThread);
+        if (begin >= end) break;
+        workers.push_back(thread(sweep, begin, end));
+    }
+    for (auto& worker : workers) worker.join();
+    return slices;
+}
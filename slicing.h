@@ -0,0 +1,30 @@
+#ifndef SLICING_H
+#define SLICING_H
+
+#include "input.h"
+#include "projections.h"
+
+// One closed cross-section loop in the plane's (u, v) coordinates (see planeBasis)
+struct SliceContour {
+    vector<Point2D> points;
+    double area; // Signed: positive for material boundaries, negative around holes
+};
+
+struct Slice {
+    double offset;                  // D of the plane Ax + By + Cz = D
+    vector<SliceContour> contours;
+    double area;                    // Net cross-section area (holes subtracted)
+    size_t openChains;              // Segments that did not close into a loop
+};
+
+// Cuts the polyhedron (holes included) with the parallel planes Ax + By + Cz = D
+// for each D in `offsets`. Faces are fan-triangulated once and sorted by their
+// extent along the normal; each worker thread sweeps a contiguous range of
+// planes with an active-triangle list, so every triangle is visited only by
+// the planes that cross it. Expects faces oriented by orientPolyhedron, which
+// makes outer contours counter-clockwise and hole contours clockwise.
+// Results are returned in the order of `offsets`.
+vector<Slice> slicePolyhedron(const Polyhedron& poly, double A, double B, double C,
+                              const vector<double>& offsets, unsigned numThreads = 0);
+
+#endif
@@ -0,0 +1,312 @@
+#include "stream.h"
+#include "bounded_queue.h"
+#include "facemesh.h"
+#include "geometry.h"
+#include "halfedge.h"
+#include "validity.h"
+#include "weld.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+using namespace Eigen;
+
+// Vertex table of one shell; shared by every chunk of that shell's faces and
+// released as soon as the last of those chunks has been accumulated
+struct StreamShell {
+    vector<Vertex> vertices;
+    int depth;         // 0 for the outer shell, 1 for its holes, ...
+    string name;
+};
+
+// A batch of faces stored as flat index buffers instead of Edge copies
+struct FaceChunk {
+    shared_ptr<const StreamShell> shell;
+    vector<int> edgeCounts;     // number of edges in each face
+    vector<int> edgeVertices;   // (v1, v2) pairs, 0-based, for every edge
+    vector<char> flipped;       // Set by stage 2: the face's loop runs against its oriented shell
+    bool endOfShell;
+};
+
+// Stage 1: parse the token stream, reconstruct vertices and cut faces into chunks
+static bool readShell(FILE* in, int depth, const string& name, size_t chunkFaces, double weldTolerance,
+                      const Reconstructor& views, BoundedQueue<FaceChunk>& out, size_t& numShells, size_t& numMerged,
+                      ReconstructionReport& reconstruction) {
+    int numVertices, numFaces;
+    if (fscanf(in, "%d %d", &numVertices, &numFaces) != 2 || numVertices < 0 || numFaces < 0) {
+        printf("Malformed vertex/face count in the %s polyhedron\n", name.c_str());
+        return false;
+    }
+
+    shared_ptr<StreamShell> shell = make_shared<StreamShell>();
+    shell->vertices.resize(numVertices);
+    shell->depth = depth;
+    shell->name = name;
+    numShells++;
+
+    // Reconstruct 3D vertices from every view in one batch, reusing one factorization
+    const size_t numValues = 2 * views.numViews();
+    vector<double> coords(numVertices * numValues);
+    for (int i = 0; i < numVertices; ++i) {
+        for (size_t k = 0; k < numValues; ++k) {
+            if (fscanf(in, "%lf", &coords[i * numValues + k]) != 1) {
+                printf("Malformed coordinates for vertex %d of the %s polyhedron\n", i + 1, name.c_str());
+                return false;
+            }
+        }
+    }
+    vector<double> residuals(numVertices);
+    views.solve(coords.data(), numVertices, shell->vertices.data(), residuals.data());
+    reconstruction.add(views, name, residuals.data(), residuals.size());
+
+    // Weld before any face is read so edges are remapped as they are parsed
+    vector<int> remap;
+    numMerged += weldVertexTable(shell->vertices, weldTolerance, remap);
+
+    FaceChunk chunk;
+    chunk.shell = shell;
+    chunk.endOfShell = false;
+    for (int i = 0; i < numFaces; i++) {
+        int numEdges;
+        if (fscanf(in, "%d", &numEdges) != 1 || numEdges < 0) {
+            printf("Malformed edge count for face %d of the %s polyhedron\n", i + 1, name.c_str());
+            return false;
+        }
+        // Edges whose ends were welded together are dropped, as weldPolyhedron does
+        int kept = 0;
+        for (int j = 0; j < numEdges; j++) {
+            int v1, v2;
+            if (fscanf(in, "%d %d", &v1, &v2) != 2 || v1 < 1 || v2 < 1 || v1 > numVertices || v2 > numVertices) {
+                printf("Invalid vertices for edge %d in face %d of the %s polyhedron\n", j + 1, i + 1, name.c_str());
+                return false;
+            }
+            if (remap[v1 - 1] == remap[v2 - 1]) continue;
+            chunk.edgeVertices.push_back(remap[v1 - 1]);
+            chunk.edgeVertices.push_back(remap[v2 - 1]);
+            kept++;
+        }
+        chunk.edgeCounts.push_back(kept);
+
+        if (chunk.edgeCounts.size() == chunkFaces) {
+            if (!out.push(std::move(chunk))) return false;
+            chunk = FaceChunk();
+            chunk.shell = shell;
+            chunk.endOfShell = false;
+        }
+    }
+    chunk.endOfShell = true;
+    if (!out.push(std::move(chunk))) return false;
+    shell.reset();
+
+    int numSubPolyhedrons;
+    if (fscanf(in, "%d", &numSubPolyhedrons) != 1 || numSubPolyhedrons < 0) {
+        printf("Malformed hole count in the %s polyhedron\n", name.c_str());
+        return false;
+    }
+    for (int i = 0; i < numSubPolyhedrons; ++i) {
+        if (!readShell(in, depth + 1, "internal hole " + to_string(i + 1), chunkFaces, weldTolerance,
+                       views, out, numShells, numMerged, reconstruction)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Each face's loop (the v1 of every edge) in the flat form buildHalfEdgeMesh takes
+static void appendFaceLoops(const FaceChunk& chunk, vector<int>& faceSizes, vector<int>& faceIndices) {
+    size_t offset = 0;
+    for (int numEdges : chunk.edgeCounts) {
+        faceSizes.push_back(numEdges);
+        for (int j = 0; j < numEdges; j++) {
+            faceIndices.push_back(chunk.edgeVertices[offset + 2 * j]);
+        }
+        offset += 2 * numEdges;
+    }
+}
+
+// Undirected edge as (smaller index, larger index) in one word. Welded
+// indices stand for vertex values, as checkClosedPolyhedron keys its map.
+static uint64_t edgeKey(int a, int b) {
+    if (a > b) swap(a, b);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+
+// Stage 2: the per-face checks of checkCollinearityAndPlanarity, plus the
+// uses of each edge of the shell for checkClosedPolyhedron's test, which is
+// made once the shell's last chunk has been counted
+static bool validateChunk(const FaceChunk& chunk, size_t& faceIndex, unordered_map<uint64_t, int>& edgeUses) {
+    const vector<Vertex>& V = chunk.shell->vertices;
+    const char* name = chunk.shell->name.c_str();
+    bool valid = true;
+    vector<Vertex> faceVertices;
+
+    size_t offset = 0;
+    for (size_t f = 0; f < chunk.edgeCounts.size(); f++, faceIndex++) {
+        int numEdges = chunk.edgeCounts[f];
+        faceVertices.clear();
+        for (int j = 0; j < numEdges; j++) {
+            int v1 = chunk.edgeVertices[offset + 2 * j];
+            int v2 = chunk.edgeVertices[offset + 2 * j + 1];
+            faceVertices.push_back(V[v1]);
+            edgeUses[edgeKey(v1, v2)]++;
+        }
+        offset += 2 * numEdges;
+
+        if (!valid) continue;  // Only report the first problem, like validateInput
+        if (faceVertices.size() >= 3) {
+            for (size_t k = 0; k < faceVertices.size() - 2; ++k) {
+                if (checkCollinearity(faceVertices[k], faceVertices[k + 1], faceVertices[k + 2])) {
+                    printf("Collinearity detected for points in face %zu of the %s polyhedron\n", faceIndex + 1, name);
+                    valid = false;
+                    break;
+                }
+            }
+        }
+        if (valid && !checkPlanarity(faceVertices)) {
+            printf("Non-planar face detected for face %zu of the %s polyhedron\n", faceIndex + 1, name);
+            valid = false;
+        }
+    }
+
+    if (chunk.endOfShell) {
+        for (const auto& entry : edgeUses) {
+            if (entry.second != 2) {
+                const Vertex& a = V[entry.first >> 32];
+                const Vertex& b = V[entry.first & 0xffffffffu];
+                printf("Edge between vertices (%.2f, %.2f, %.2f) and (%.2f, %.2f, %.2f) is not shared by exactly two "
+                       "faces in the %s polyhedron\n", a.x, a.y, a.z, b.x, b.y, b.z, name);
+                valid = false;
+                break;
+            }
+        }
+    }
+    return valid;
+}
+
+StreamResult streamAnalyse(FILE* in, const Reconstructor& views, const Vertex& origin, double density, double weldTolerance,
+                           size_t chunkFaces, size_t queueDepth) {
+    StreamResult result;
+    result.valid = true;
+    result.numShells = 0;
+    result.numMerged = 0;
+    result.numFaces = 0;
+    result.surfaceArea = 0.0f;
+    result.volume = 0.0;
+    result.centerOfMass = {0, 0, 0};
+    if (chunkFaces == 0) chunkFaces = 1;
+
+    BoundedQueue<FaceChunk> parsed(queueDepth);
+    BoundedQueue<FaceChunk> validated(queueDepth);
+    atomic<bool> readOk(true);
+    atomic<bool> facesValid(true);
+
+    thread reader([&]() {
+        if (!readShell(in, 0, "outer", chunkFaces, weldTolerance, views, parsed,
+                       result.numShells, result.numMerged, result.reconstruction)) {
+            readOk = false;
+        }
+        parsed.close();
+    });
+
+    // Stage 2 also orients each shell the way orientPolyhedron would. That
+    // needs the whole shell, so its chunks are held here until it ends and
+    // then passed on together with the faces to flip.
+    thread validator([&]() {
+        size_t faceIndex = 0;
+        unordered_map<uint64_t, int> edgeUses;
+        bool valid = true;
+        vector<FaceChunk> shellChunks;
+        vector<int> faceSizes, faceIndices;
+        OrientationReport orientation;
+        FaceChunk chunk;
+        while (parsed.pop(chunk)) {
+            if (!validateChunk(chunk, faceIndex, edgeUses)) valid = false;
+            appendFaceLoops(chunk, faceSizes, faceIndices);
+            bool endOfShell = chunk.endOfShell;
+            shellChunks.push_back(std::move(chunk));
+            if (!endOfShell) continue;
+
+            const StreamShell& shell = *shellChunks.back().shell;
+            HalfEdgeMesh mesh = buildHalfEdgeMesh(static_cast<int>(shell.vertices.size()), faceSizes, faceIndices);
+            vector<char> flip = orientationFlips(mesh, shell.vertices.data(), shell.depth, orientation);
+            size_t next = 0;
+            bool open = true;
+            for (FaceChunk& held : shellChunks) {
+                held.flipped.assign(flip.begin() + next, flip.begin() + next + held.edgeCounts.size());
+                next += held.edgeCounts.size();
+                if (open && !validated.push(std::move(held))) open = false;
+            }
+            if (!open) break;
+            shellChunks.clear();
+            faceSizes.clear();
+            faceIndices.clear();
+            faceIndex = 0;
+            edgeUses.clear();
+        }
+        facesValid = valid;
+        validated.close();
+    });
+
+    // Stage 3: accumulate the mass properties on this thread with the same
+    // face kernels as computeMassProperties, each face wound as stage 2 oriented it
+    VolumeIntegrals sums;
+    vector<int> loop;
+    FaceChunk chunk;
+    while (validated.pop(chunk)) {
+        const Vertex* V = chunk.shell->vertices.data();
+        bool outer = chunk.shell->depth == 0;
+
+        size_t offset = 0;
+        for (size_t f = 0; f < chunk.edgeCounts.size(); f++) {
+            int numEdges = chunk.edgeCounts[f];
+            const int* e = &chunk.edgeVertices[offset];
+            offset += 2 * numEdges;
+            result.numFaces++;
+
+            loop.clear();
+            for (int j = 0; j < numEdges; j++) loop.push_back(e[2 * j]);
+            if (chunk.flipped[f]) reverse(loop.begin() + (numEdges > 0 ? 1 : 0), loop.end());
+            if (outer) {
+                Vertex area = faceVectorArea<0>(V, loop.data(), numEdges);
+                result.surfaceArea += sqrt(area.x * area.x + area.y * area.y + area.z * area.z) / 2.0;
+            }
+            accumulateFaceIntegrals<0>(V, loop.data(), numEdges, origin, sums);
+        }
+    }
+
+    reader.join();
+    validator.join();
+    result.valid = readOk && facesValid;
+
+    MassProperties props = massPropertiesFromIntegrals(sums, origin, density);
+    result.volume = props.volume;
+    result.inertia = props.inertia;
+    if (props.volume > 0) {
+        result.centerOfMass = props.centerOfMass;
+        if (std::fabs(result.centerOfMass.x) < EPSILON) result.centerOfMass.x = 0;
+        if (std::fabs(result.centerOfMass.y) < EPSILON) result.centerOfMass.y = 0;
+        if (std::fabs(result.centerOfMass.z) < EPSILON) result.centerOfMass.z = 0;
+    }
+    return result;
+}
+
+void printStreamResult(const StreamResult& result) {
+    printf("Streamed %zu faces in %zu shell(s), %zu vertices welded\n",
+           result.numFaces, result.numShells, result.numMerged);
+    printReconstructionReport(result.reconstruction);
+    if (result.valid) {
+        printf("The input and reconstruction are valid.\n");
+    } else {
+        printf("The input or reconstruction is invalid.\n");
+    }
+    printf("The Surface Area of the polyhedron is: %f\n", result.surfaceArea);
+    printf("The Volume of the polyhedron is: %f\n", result.volume);
+    printf("The Centre of Mass of the polyhedron is: %f, %f, %f\n",
+           result.centerOfMass.x, result.centerOfMass.y, result.centerOfMass.z);
+    printf("Inertia Tensor: \nIxx: %lf, Iyy: %lf, Izz: %lf\n", result.inertia.Ixx, result.inertia.Iyy, result.inertia.Izz);
+    printf("Ixy: %lf, Ixz: %lf, Iyz: %lf\n", result.inertia.Ixy, result.inertia.Ixz, result.inertia.Iyz);
+}
@@ -0,0 +1,37 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "input.h"
+#include "reconstruction.h"
+
+// Result of a streaming analysis run. Each shell is oriented as
+// orientPolyhedron would, and the sums use the face kernels of
+// computeMassProperties, so both paths agree on the same input.
+struct StreamResult {
+    bool valid;
+    size_t numShells;
+    size_t numFaces;
+    size_t numMerged;         // vertices removed by welding
+    float surfaceArea;        // outer shell only, same as calculateSurfaceArea
+    double volume;            // holes subtracted, same as computeMassProperties
+    Vertex centerOfMass;
+    InertiaTensor inertia;    // about the given origin
+    ReconstructionReport reconstruction;
+};
+
+// Reads a polyhedron in the same token order as getInput (without prompts) and
+// computes validation and mass properties in a chunked three-stage pipeline:
+// parse/reconstruct -> per-face validation and orientation -> accumulation.
+// Faces are never materialized as a Polyhedron; at most `queueDepth` chunks
+// of `chunkFaces` faces are queued between stages. Orientation holds one
+// shell's chunks at a time in stage 2, so memory grows with the largest
+// shell rather than the whole input. Vertex tables stay resident only while
+// faces of their shell are in flight, since face edges index into them. Each
+// vertex table is welded with `weldTolerance` before its faces are parsed.
+StreamResult streamAnalyse(FILE* in, const Reconstructor& views, const Vertex& origin, double density,
+                           double weldTolerance = WELD_TOLERANCE,
+                           size_t chunkFaces = 4096, size_t queueDepth = 4);
+
+void printStreamResult(const StreamResult& result);
+
+#endif
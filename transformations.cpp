@@ -101,39 +101,10 @@ void reflect_polyhedron(Polyhedron &poly, double A, double B, double C, double D
     }
 }
 
-bool getValidatedDouble(double &value, const std::string &prompt) {
-    std::cout << prompt;
-    while (!(std::cin >> value)) {
-        std::cout << "Invalid input. Please enter a number.\n" << prompt;
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-    return true;
-}
-
-bool getValidatedFloat(float &value, const std::string &prompt) {
-    std::cout << prompt;
-    while (!(std::cin >> value)) {
-        std::cout << "Invalid input. Please enter a number.\n" << prompt;
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-    return true;
-}
-
-bool getValidatedChoice(int &choice, int min, int max, const std::string &prompt) {
-    std::cout << prompt;
-    while (!(std::cin >> choice) || choice < min || choice > max) {
-        std::cout << "Invalid input. Please enter a number between " << min << " and " << max << ".\n" << prompt;
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-    return true;
-}
-
 Polyhedron deep_copy(const Polyhedron &poly) {
     Polyhedron copy;
     copy.vertices = poly.vertices; // Copy vertices
+    copy.faces = poly.faces;       // Copy faces and their edges
 
     // Recursively deep copy sub-polyhedrons
     for (const auto &sub_poly : poly.sub_polyhedrons) {
@@ -145,7 +116,9 @@ Polyhedron deep_copy(const Polyhedron &poly) {
 void update_edges(Polyhedron& poly) {
     for (auto& face : poly.faces) {
         for (auto& edge : face.edges) {
-            // Directly use the vertices from the edge
+            // Refresh the edge's copies of its end points from the transformed vertices
+            edge.v1 = poly.vertices[edge.i1];
+            edge.v2 = poly.vertices[edge.i2];
             edge.length = computeDistance(edge.v1, edge.v2); // Recalculate length based on updated vertices
         }
     }
@@ -155,81 +128,3 @@ void update_edges(Polyhedron& poly) {
         update_edges(sub_poly);
     }
 }
-
-void transform_polyhedron(const Polyhedron &poly) {
-    // Clone poly so the original is unchanged
-    Polyhedron poly_copy = deep_copy(poly);
-
-    int choice;
-    getValidatedChoice(choice, 1, 4, "Choose transformation:\n1. Rotate around a plane\n2. Translate\n3. Scale\n4. Reflect across a plane\n");
-
-    switch (choice) {
-        case 1: { // Rotate
-            double angle;
-            float A, B, C, D;
-            getValidatedDouble(angle, "Enter the rotation angle (in degrees): ");
-            
-            std::cout << "Enter the coefficients of the plane equation (Ax + By + Cz = D):\n";
-            getValidatedFloat(A, "A (normal x-component): ");
-            getValidatedFloat(B, "B (normal y-component): ");
-            getValidatedFloat(C, "C (normal z-component): ");
-            getValidatedFloat(D, "D (distance from origin): ");
-
-            if (A == 0 && B == 0 && C == 0) {
-                std::cout << "Error: The normal vector cannot be zero. Rotation canceled.\n";
-                return;
-            }
-
-            rotate_polyhedron(poly_copy, angle, A, B, C);
-            std::cout << "\nRotated Polyhedron:\n";
-            update_edges(poly_copy);
-            printPolyhedron(poly_copy);
-            break;
-        }
-        case 2: { // Translate
-            double dx, dy, dz;
-            getValidatedDouble(dx, "Enter translation value dx: ");
-            getValidatedDouble(dy, "Enter translation value dy: ");
-            getValidatedDouble(dz, "Enter translation value dz: ");
-
-            translate_polyhedron(poly_copy, dx, dy, dz);
-            std::cout << "\nTranslated Polyhedron:\n";
-            update_edges(poly_copy);
-            printPolyhedron(poly_copy);
-            break;
-        }
-        case 3: { // Scale
-            double sx, sy, sz;
-            getValidatedDouble(sx, "Enter scaling factor sx: ");
-            getValidatedDouble(sy, "Enter scaling factor sy: ");
-            getValidatedDouble(sz, "Enter scaling factor sz: ");
-
-            scale_polyhedron(poly_copy, sx, sy, sz);
-            std::cout << "\nScaled Polyhedron:\n";
-            update_edges(poly_copy);
-            printPolyhedron(poly_copy);
-            break;
-        }
-        case 4: { // Reflect
-            float A, B, C, D;
-            std::cout << "Enter the coefficients of the plane equation (Ax + By + Cz = D):\n";
-            getValidatedFloat(A, "A (normal x-component): ");
-            getValidatedFloat(B, "B (normal y-component): ");
-            getValidatedFloat(C, "C (normal z-component): ");
-            getValidatedFloat(D, "D (distance from origin): ");
-
-            if (A == 0 && B == 0 && C == 0) {
-                std::cout << "Error: The normal vector cannot be zero. Reflection canceled.\n";
-                return;
-            }
-
-            reflect_polyhedron(poly_copy, A, B, C, D);
-            std::cout << "\nReflected Polyhedron:\n";
-            update_edges(poly_copy);
-            printPolyhedron(poly_copy);
-            break;
-        }
-        default:
-            std::cout << "Invalid choice\n";
-    }
-}
\ No newline at end of file
@@ -14,12 +14,18 @@ void translate_polyhedron(Polyhedron &poly, double dx, double dy, double dz);
 void scale_polyhedron(Polyhedron &poly, double sx, double sy, double sz);
 void reflect_polyhedron(Polyhedron &poly, double A, double B, double C, double D);
 
-bool getValidatedDouble(double &value, const std::string &prompt);
-bool getValidatedFloat(float &value, const std::string &prompt);
-bool getValidatedChoice(int &choice, int min, int max, const std::string &prompt);
 Polyhedron deep_copy(const Polyhedron &poly);
 void update_edges(Polyhedron& poly);
 
-void transform_polyhedron(const Polyhedron &poly);
+class TransformHistory;
+struct TransformOp;
+
+// Interactive transformation menu, in input.cpp with the other prompts.
+// Transformations are committed to the history; returns true if its
+// current version changed.
+bool transform_polyhedron(TransformHistory &history);
+// Asks for the parameters of menu choice 1-4 (rotate, translate, scale,
+// reflect); false if they were rejected
+bool promptTransformOp(int choice, TransformOp &op);
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "validity.h"
+#include "facemesh.h"
 
 using namespace std;
 using namespace Eigen;
@@ -51,28 +52,41 @@ bool checkEdgeLengthConsistency(const Polyhedron& poly, const std::string& polyT
     return true;
 }
 
-bool checkCollinearityAndPlanarity(const Polyhedron& poly, const std::string& polyType) {
-    for (size_t i = 0; i < poly.faces.size(); i++) {
-        std::vector<Vertex> faceVertices;
-        for (size_t j = 0; j < poly.faces[i].edges.size(); j++) {
-            faceVertices.push_back(poly.faces[i].edges[j].v1);
+// Lowest-numbered face of the group failing the collinearity or planarity test, or -1
+template <int N>
+static int firstBadFace(const FaceMesh& mesh, const FaceGroup& group, bool& collinear) {
+    const Vertex* vertices = mesh.vertices.data();
+    int badFace = -1;
+    forEachFace<N>(group, [&](const int* idx, int n, int faceId) {
+        if (badFace >= 0) return;  // Face ids rise within a group
+        bool hasRun = faceHasCollinearRun<N>(vertices, idx, n);
+        if (hasRun || !faceIsPlanar<N>(vertices, idx, n)) {
+            badFace = faceId;
+            collinear = hasRun;
         }
+    });
+    return badFace;
+}
 
-        if (faceVertices.size() >= 3) {
-            for (size_t k = 0; k < faceVertices.size() - 2; ++k) {
-                if (checkCollinearity(faceVertices[k], faceVertices[k + 1], faceVertices[k + 2])) {
-                    std::printf("Collinearity detected for points in face %zu of the %s polyhedron\n", i + 1, polyType.c_str());
-                    return false;
-                }
-            }
-        }
+bool checkCollinearityAndPlanarity(const Polyhedron& poly, const std::string& polyType) {
+    FaceMesh mesh = buildFaceMesh(poly, false);  // Each hole is checked by its own validateInput call
+
+    // Report the same face the face-order loop would have reported first
+    bool collinear[3] = {false, false, false};
+    int bad[3] = {firstBadFace<3>(mesh, mesh.triangles, collinear[0]), firstBadFace<4>(mesh, mesh.quads, collinear[1]),
+                  firstBadFace<0>(mesh, mesh.polygons, collinear[2])};
+    int worst = -1;
+    for (int g = 0; g < 3; ++g) {
+        if (bad[g] >= 0 && (worst < 0 || bad[g] < bad[worst])) worst = g;
+    }
+    if (worst < 0) return true;
 
-        if (!checkPlanarity(faceVertices)) {
-            std::printf("Non-planar face detected for face %zu of the %s polyhedron\n", i + 1, polyType.c_str());
-            return false;
-        }
+    if (collinear[worst]) {
+        std::printf("Collinearity detected for points in face %d of the %s polyhedron\n", bad[worst] + 1, polyType.c_str());
+    } else {
+        std::printf("Non-planar face detected for face %d of the %s polyhedron\n", bad[worst] + 1, polyType.c_str());
     }
-    return true;
+    return false;
 }
 
 bool checkClosedPolyhedron(const Polyhedron& poly, const std::string& polyType) {
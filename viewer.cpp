@@ -0,0 +1,458 @@
+#include "viewer.h"
+#include "projections.h"
+#include "scene.h"
+#include "lod.h"
+#include "animation.h"
+#include "deviation.h"
+
+using namespace std;
+
+void GeometryStore::commit(const Polyhedron& poly) {
+    commit(make_shared<const Polyhedron>(poly));
+}
+
+void GeometryStore::commit(shared_ptr<const Polyhedron> poly) {
+    lock_guard<mutex> lock(mutex_);
+    current_ = poly;
+    lod_.reset();
+    deviation_.reset();
+    version_++;
+}
+
+shared_ptr<const Polyhedron> GeometryStore::snapshot() const {
+    lock_guard<mutex> lock(mutex_);
+    return current_;
+}
+
+unsigned GeometryStore::version() const {
+    lock_guard<mutex> lock(mutex_);
+    return version_;
+}
+
+void GeometryStore::commitScene(shared_ptr<const Scene> scene) {
+    lock_guard<mutex> lock(mutex_);
+    scene_ = scene;
+    version_++;
+}
+
+shared_ptr<const Scene> GeometryStore::sceneSnapshot() const {
+    lock_guard<mutex> lock(mutex_);
+    return scene_;
+}
+
+void GeometryStore::commitLod(shared_ptr<const Polyhedron> source, shared_ptr<const PolyhedronLod> lod) {
+    lock_guard<mutex> lock(mutex_);
+    if (source == current_) lod_ = lod;
+}
+
+shared_ptr<const PolyhedronLod> GeometryStore::lodSnapshot() const {
+    lock_guard<mutex> lock(mutex_);
+    return lod_;
+}
+
+void GeometryStore::commitAnimation(shared_ptr<const Animation> animation) {
+    lock_guard<mutex> lock(mutex_);
+    animation_ = animation;
+    version_++;
+}
+
+shared_ptr<const Animation> GeometryStore::animationSnapshot() const {
+    lock_guard<mutex> lock(mutex_);
+    return animation_;
+}
+
+void GeometryStore::commitDeviation(shared_ptr<const Polyhedron> source, shared_ptr<const DeviationReport> deviation) {
+    lock_guard<mutex> lock(mutex_);
+    if (source == current_) {
+        deviation_ = deviation;
+        version_++;
+    }
+}
+
+shared_ptr<const DeviationReport> GeometryStore::deviationSnapshot() const {
+    lock_guard<mutex> lock(mutex_);
+    return deviation_;
+}
+
+UiHost::UiHost(GeometryStore& store) : store_(store) {}
+
+UiHost::~UiHost() {}
+
+void UiHost::openIsometricView() {
+    lock_guard<mutex> lock(mutex_);
+    openRequested_ = true;
+    wake_.notify_one();
+}
+
+void UiHost::post(function<void()> job) {
+    lock_guard<mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+    wake_.notify_one();
+}
+
+void UiHost::shutdown() {
+    lock_guard<mutex> lock(mutex_);
+    stopping_ = true;
+    wake_.notify_one();
+}
+
+void UiHost::run() {
+    while (true) {
+        function<void()> job;
+        bool open = false;
+        {
+            unique_lock<mutex> lock(mutex_);
+            // Sleep while there is nothing to draw; otherwise just peek for requests
+            if (!window_) {
+                wake_.wait(lock, [this] { return stopping_ || openRequested_ || !jobs_.empty(); });
+            }
+            if (stopping_) break;
+            if (!jobs_.empty()) {
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            open = openRequested_;
+            openRequested_ = false;
+        }
+
+        if (job) job();
+
+        if (open && !window_) {
+            SDL_InitSubSystem(SDL_INIT_VIDEO);
+            window_ = SDL_CreateWindow("Isometric View", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+            renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
+        }
+        if (window_) renderFrame();
+    }
+
+    if (window_) {
+        SDL_DestroyRenderer(renderer_);
+        SDL_DestroyWindow(window_);
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        window_ = nullptr;
+    }
+    SDL_Quit();
+}
+
+void UiHost::renderFrame() {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            SDL_DestroyRenderer(renderer_);
+            SDL_DestroyWindow(window_);
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            window_ = nullptr;
+            renderer_ = nullptr;
+            player_.reset();
+            return;
+        } else if (event.type == SDL_MOUSEMOTION && (event.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT))) {
+            angleX_ += event.motion.yrel * 0.01f;
+            angleY_ += event.motion.xrel * 0.01f;
+            lastRotation_ = chrono::steady_clock::now();
+        }
+    }
+
+    chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+    SDL_SetRenderDrawColor(renderer_, 245, 245, 245, 255); // Light gray background
+    SDL_RenderClear(renderer_);
+
+    // Define colors for outer and inner polyhedrons
+    SDL_Color outerColor = {0, 100, 255, 255};  // Outer polyhedron color (e.g., blue)
+    SDL_Color innerColor = {255, 100, 100, 255}; // Inner polyhedron color (e.g., red)
+
+    // Draw whatever was committed last; a new commit shows up on the next frame
+    shared_ptr<const Scene> scene = store_.sceneSnapshot();
+    shared_ptr<const Polyhedron> poly = store_.snapshot();
+    shared_ptr<const PolyhedronLod> lod = store_.lodSnapshot();
+    shared_ptr<const Animation> animation = store_.animationSnapshot();
+    shared_ptr<const DeviationReport> deviation = store_.deviationSnapshot();
+    if (!animation || scene) player_.reset();
+    bool still = frameStart - lastRotation_ > chrono::milliseconds(LOD_SETTLE_MS);
+    size_t lodEdges = 0;
+    if (scene) {
+        drawScene(*scene, outerColor, innerColor);
+    } else if (animation && poly) {
+        lodEdges = drawAnimation(animation, poly, lod, outerColor, innerColor);
+    } else if (deviation && poly && (still || !lod)) {
+        // The heat map fills every face of the full mesh, so the levels of
+        // detail stand in for it while the view moves
+        drawDeviation(*poly, *deviation);
+    } else if (lod) {
+        lodEdges = drawLod(*lod, still, outerColor, innerColor);
+    } else if (poly) {
+        drawPolyhedron(renderer_, *poly, angleX_, angleY_, outerColor);
+        for (const auto& sub : poly->sub_polyhedrons) {
+            drawPolyhedron(renderer_, sub, angleX_, angleY_, innerColor);
+        }
+    }
+
+    SDL_RenderPresent(renderer_);
+
+    // The drawing rate sets next frame's edge budget; short frames time too coarsely to count
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+    if (lodEdges > 0 && ms > 0.5) {
+        double rate = lodEdges / ms;
+        edgesPerMs_ = edgesPerMs_ > 0 ? 0.9 * edgesPerMs_ + 0.1 * rate : rate;
+    }
+    // Sleep only for what is left of the frame, so slow frames do not fall further behind
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+    if (elapsed < FRAME_MS) SDL_Delay(static_cast<Uint32>(FRAME_MS - elapsed));
+}
+
+// screen = M v + offset for each vertex, into `out`
+static void projectVertices(const vector<Vertex>& vertices, const double M[2][3], const double offset[2], vector<SDL_Point>& out) {
+    out.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        out[i].x = static_cast<int>(M[0][0] * v.x + M[0][1] * v.y + M[0][2] * v.z + offset[0]);
+        out[i].y = static_cast<int>(M[1][0] * v.x + M[1][1] * v.y + M[1][2] * v.z + offset[1]);
+    }
+}
+
+// Each instance folds its transform into the 2x3 view matrix and projects
+// the shared mesh's vertices into one reused buffer, then draws the mesh's
+// unique edges from it; nothing per instance is allocated or copied.
+void UiHost::drawScene(const Scene& scene, SDL_Color outerColor, SDL_Color innerColor) {
+    double view[2][3];
+    isometricMatrix(angleX_, angleY_, view);
+
+    for (const SceneInstance& instance : scene.instances()) {
+        const SceneMesh& mesh = scene.mesh(instance.mesh);
+        const AffineMap& pose = instance.transform;
+        double M[2][3], offset[2];
+        for (int r = 0; r < 2; ++r) {
+            offset[r] = (r == 0 ? SCREEN_WIDTH : SCREEN_HEIGHT) / 2;
+            for (int k = 0; k < 3; ++k) {
+                M[r][k] = view[r][0] * pose.linear(0, k) + view[r][1] * pose.linear(1, k) + view[r][2] * pose.linear(2, k);
+                offset[r] += view[r][k] * pose.translation(k);
+            }
+        }
+
+        projectVertices(mesh.drawVertices, M, offset, projected_);
+
+        SDL_SetRenderDrawColor(renderer_, outerColor.r, outerColor.g, outerColor.b, outerColor.a);
+        for (size_t e = 0; e < mesh.drawEdges.size() / 2; ++e) {
+            if (e == mesh.outerEdges) {
+                SDL_SetRenderDrawColor(renderer_, innerColor.r, innerColor.g, innerColor.b, innerColor.a);
+            }
+            const SDL_Point& a = projected_[mesh.drawEdges[2 * e]];
+            const SDL_Point& b = projected_[mesh.drawEdges[2 * e + 1]];
+            SDL_RenderDrawLine(renderer_, a.x, a.y, b.x, b.y);
+        }
+    }
+}
+
+// While the view moves, each shell shows the coarsest level whose error stays
+// under LOD_PIXEL_TOLERANCE, coarser still when the shells together would take
+// longer than LOD_FRAME_BUDGET_MS at the measured drawing rate. The budget is
+// shared out in proportion to each shell's full edge count. Returns the
+// number of edges drawn.
+size_t UiHost::drawLod(const PolyhedronLod& lod, bool fullDetail, SDL_Color outerColor, SDL_Color innerColor) {
+    double view[2][3];
+    isometricMatrix(angleX_, angleY_, view);
+    double offset[2] = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2};
+    double pixelsPerUnit = 0;
+    for (int r = 0; r < 2; ++r) {
+        pixelsPerUnit = max(pixelsPerUnit, sqrt(view[r][0] * view[r][0] + view[r][1] * view[r][1] + view[r][2] * view[r][2]));
+    }
+
+    size_t drawn = 0;
+    for (const LodChain& chain : lod.shells) {
+        int level = 0;
+        if (!fullDetail) {
+            size_t edgeBudget = numeric_limits<size_t>::max();
+            if (edgesPerMs_ > 0) {
+                double share = static_cast<double>(chain.levels[0].edges.size() / 2) / max<size_t>(lod.fullEdges, 1);
+                edgeBudget = static_cast<size_t>(edgesPerMs_ * LOD_FRAME_BUDGET_MS * share);
+            }
+            level = pickLodLevel(chain, pixelsPerUnit, LOD_PIXEL_TOLERANCE, edgeBudget);
+        }
+        const LodLevel& shown = chain.levels[level];
+        projectVertices(shown.vertices, view, offset, projected_);
+
+        SDL_Color color = chain.depth % 2 == 0 ? outerColor : innerColor;
+        SDL_SetRenderDrawColor(renderer_, color.r, color.g, color.b, color.a);
+        for (size_t e = 0; e < shown.edges.size() / 2; ++e) {
+            const SDL_Point& a = projected_[shown.edges[2 * e]];
+            const SDL_Point& b = projected_[shown.edges[2 * e + 1]];
+            SDL_RenderDrawLine(renderer_, a.x, a.y, b.x, b.y);
+        }
+        drawn += shown.edges.size() / 2;
+    }
+    return drawn;
+}
+
+// The player projects one frame ahead on its own thread, so this frame only
+// draws lines from the points it finished while the last frame was drawn,
+// then asks for the pose one display interval later. The edge budget is the
+// same as drawLod's while rotating. Returns the number of edges drawn.
+size_t UiHost::drawAnimation(shared_ptr<const Animation> animation, shared_ptr<const Polyhedron> poly,
+                             shared_ptr<const PolyhedronLod> lod, SDL_Color outerColor, SDL_Color innerColor) {
+    double view[2][3];
+    isometricMatrix(angleX_, angleY_, view);
+    size_t edgeBudget = numeric_limits<size_t>::max();
+    if (edgesPerMs_ > 0) {
+        edgeBudget = static_cast<size_t>(edgesPerMs_ * LOD_FRAME_BUDGET_MS);
+    }
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (!player_ || player_->animation() != animation.get() || player_->source() != poly.get() ||
+        player_->lod() != lod.get()) {
+        // A new part or newer levels keep the clock; only a new animation restarts it
+        if (!player_ || player_->animation() != animation.get()) animationStart_ = now;
+        player_.reset(new AnimationPlayer(animation, poly, lod));
+        player_->request(chrono::duration<double>(now - animationStart_).count(), view, edgeBudget);
+    }
+
+    const AnimationFrame& frame = player_->take();
+    double next = chrono::duration<double>(now - animationStart_).count() + FRAME_MS / 1000.0;
+    player_->request(next, view, edgeBudget);
+
+    const PolyhedronLod& levels = player_->levels();
+    for (size_t s = 0; s < levels.shells.size(); ++s) {
+        const LodChain& chain = levels.shells[s];
+        const LodLevel& shown = chain.levels[frame.levels[s]];
+        const SDL_Point* points = frame.points.data() + player_->shellOffset(s);
+
+        SDL_Color color = chain.depth % 2 == 0 ? outerColor : innerColor;
+        SDL_SetRenderDrawColor(renderer_, color.r, color.g, color.b, color.a);
+        for (size_t e = 0; e < shown.edges.size() / 2; ++e) {
+            const SDL_Point& a = points[shown.edges[2 * e]];
+            const SDL_Point& b = points[shown.edges[2 * e + 1]];
+            SDL_RenderDrawLine(renderer_, a.x, a.y, b.x, b.y);
+        }
+    }
+    return frame.edges;
+}
+
+// Blue where the surfaces agree through green and yellow to red at the largest deviation
+static SDL_Color heatColor(double t) {
+    t = min(max(t, 0.0), 1.0);
+    double r = min(max(2 * t - 0.5, 0.0), 1.0);
+    double g = t < 0.75 ? min(2 * t, 1.0) : 4 * (1 - t);
+    double b = max(1 - 2 * t, 0.0);
+    SDL_Color color = {static_cast<Uint8>(255 * r), static_cast<Uint8>(255 * g), static_cast<Uint8>(255 * b), 255};
+    return color;
+}
+
+// Each face's outline in the colour of its deviation; faces are numbered
+// across shells in the same order as DeviationReport::faceDeviation
+static void drawDeviationShell(SDL_Renderer* renderer, const Polyhedron& shell, const float* deviation, double scale,
+                               const double view[2][3], vector<SDL_Point>& projected, size_t& face) {
+    const double offset[2] = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2};
+    projectVertices(shell.vertices, view, offset, projected);
+    for (const Face& f : shell.faces) {
+        SDL_Color color = heatColor(scale > 0 ? deviation[face] / scale : 0);
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        for (const Edge& edge : f.edges) {
+            const SDL_Point& a = projected[edge.i1];
+            const SDL_Point& b = projected[edge.i2];
+            SDL_RenderDrawLine(renderer, a.x, a.y, b.x, b.y);
+        }
+        ++face;
+    }
+    for (const Polyhedron& hole : shell.sub_polyhedrons) {
+        drawDeviationShell(renderer, hole, deviation, scale, view, projected, face);
+    }
+}
+
+void UiHost::drawDeviation(const Polyhedron& poly, const DeviationReport& deviation) {
+    double view[2][3];
+    isometricMatrix(angleX_, angleY_, view);
+    size_t face = 0;
+    drawDeviationShell(renderer_, poly, deviation.faceDeviation.data(), deviation.hausdorff, view, projected_, face);
+}
+
+// Draw a polyhedron with a specified color, including its sub-polyhedrons
+void drawPolyhedron(SDL_Renderer* renderer, const Polyhedron& polyhedron, float angleX, float angleY, SDL_Color color) {
+    // Set color for the current polyhedron
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+
+    // Draw edges for each face
+    for (const auto& face : polyhedron.faces) {
+        for (const auto& edge : face.edges) {
+            SDL_Point p1 = projectTo2D(edge.v1, angleX, angleY);
+            SDL_Point p2 = projectTo2D(edge.v2, angleX, angleY);
+            SDL_RenderDrawLine(renderer, p1.x, p1.y, p2.x, p2.y);
+        }
+    }
+
+    // Draw each sub-polyhedron in a different color
+    SDL_Color subColor = {
+        static_cast<Uint8>(255 - color.r),
+        static_cast<Uint8>(255 - color.g),
+        static_cast<Uint8>(255 - color.b),
+        255 // Full opacity
+    };
+    for (const auto& sub : polyhedron.sub_polyhedrons) {
+        drawPolyhedron(renderer, sub, angleX, angleY, subColor);
+    }
+}
+
+void orthographicProjectionCustomPlane(const Polyhedron& poly, float A, float B, float C, float D) {
+    (void)D;
+    SDL_InitSubSystem(SDL_INIT_VIDEO);
+
+    SDL_Window* window = SDL_CreateWindow("Orthographic Projection on Custom Plane", 
+        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderClear(renderer);
+
+    // Helper function to project and render a polyhedron
+    auto renderPolyhedron = [&](const Polyhedron& polyToRender) {
+        for (const auto& face : polyToRender.faces) {
+            for (const auto& edge : face.edges) {
+                // Determine the color based on the edge's orientation
+                Vector3d v1(edge.v1.x, edge.v1.y, edge.v1.z);
+                Vector3d v2(edge.v2.x, edge.v2.y, edge.v2.z);
+                Vector3d edgeDirection = v2 - v1;
+
+                // Normal vector of the plane
+                Vector3d planeNormal(A, B, C);
+
+                // Calculate the dot product to determine facing direction
+                if (edgeDirection.dot(planeNormal) > 0) {
+                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);  // Front-facing edges are black
+                } else {
+                    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);  // Back-facing edges are red
+                }
+
+                // Project the edge onto the plane
+                int x1 = static_cast<int>(edge.v1.x * 100 + WINDOW_WIDTH / 2);
+                int y1 = static_cast<int>(edge.v1.y * 100 + WINDOW_HEIGHT / 2);
+                int x2 = static_cast<int>(edge.v2.x * 100 + WINDOW_WIDTH / 2);
+                int y2 = static_cast<int>(edge.v2.y * 100 + WINDOW_HEIGHT / 2);
+
+                SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
+            }
+        }
+    };
+
+    // Render the outer polyhedron first
+    renderPolyhedron(poly);
+
+    // Render each sub-polyhedron (hole) within the same window
+    for (const auto& subPoly : poly.sub_polyhedrons) {
+        renderPolyhedron(subPoly);
+    }
+
+    SDL_RenderPresent(renderer);  // Present the rendered image to the screen
+
+    // Wait for a quit event to close the window
+    SDL_Event event;
+    bool quit = false;
+    while (!quit) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                quit = true;
+            }
+        }
+    }
+
+    // Cleanup
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
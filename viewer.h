@@ -0,0 +1,101 @@
+#ifndef VIEWER_H
+#define VIEWER_H
+
+#include "input.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+class Scene;
+struct PolyhedronLod;
+class Animation;
+class AnimationPlayer;
+struct DeviationReport;
+
+// Latest committed geometry. Writers publish a whole new version; readers
+// (the viewer, background tasks) take a snapshot that stays valid for as
+// long as they hold it, so nobody ever sees a half-updated polyhedron.
+class GeometryStore {
+public:
+    void commit(const Polyhedron& poly);
+    void commit(shared_ptr<const Polyhedron> poly);
+    shared_ptr<const Polyhedron> snapshot() const;
+    unsigned version() const;
+
+    // An instanced scene, drawn by the viewer in place of the single polyhedron
+    void commitScene(shared_ptr<const Scene> scene);
+    shared_ptr<const Scene> sceneSnapshot() const;
+
+    // Simplified levels for the viewer, built from `source` in the background.
+    // Dropped if another polyhedron was committed since; cleared by commit().
+    void commitLod(shared_ptr<const Polyhedron> source, shared_ptr<const PolyhedronLod> lod);
+    shared_ptr<const PolyhedronLod> lodSnapshot() const;
+
+    // Keyframed poses the viewer plays on a loop over the single polyhedron;
+    // null stops it. Kept across commit() so the part can still be edited.
+    void commitAnimation(shared_ptr<const Animation> animation);
+    shared_ptr<const Animation> animationSnapshot() const;
+
+    // Per-face deviation of `source` from a reference, coloured by the viewer.
+    // Dropped if another polyhedron was committed since; cleared by commit().
+    void commitDeviation(shared_ptr<const Polyhedron> source, shared_ptr<const DeviationReport> deviation);
+    shared_ptr<const DeviationReport> deviationSnapshot() const;
+
+private:
+    mutable mutex mutex_;
+    shared_ptr<const Polyhedron> current_;
+    shared_ptr<const Scene> scene_;
+    shared_ptr<const PolyhedronLod> lod_;
+    shared_ptr<const Animation> animation_;
+    shared_ptr<const DeviationReport> deviation_;
+    unsigned version_ = 0;
+};
+
+// SDL drawing; the projections themselves live in projections.cpp
+void drawPolyhedron(SDL_Renderer* renderer, const Polyhedron& polyhedron, float angleX, float angleY, SDL_Color color);
+void orthographicProjectionCustomPlane(const Polyhedron& poly, float A, float B, float C, float D);
+
+// Owns SDL and must run on the main thread. The menu thread asks it to open
+// the isometric viewer or to run other SDL jobs; the render loop keeps
+// drawing the store's latest snapshot every frame in the meantime.
+class UiHost {
+public:
+    explicit UiHost(GeometryStore& store);
+    ~UiHost();
+
+    void openIsometricView();        // Returns immediately
+    void post(function<void()> job); // Runs a blocking SDL job between frames
+    void shutdown();                 // Closes the viewer and makes run() return
+    void run();
+
+private:
+    void renderFrame();
+    void drawScene(const Scene& scene, SDL_Color outerColor, SDL_Color innerColor);
+    size_t drawLod(const PolyhedronLod& lod, bool fullDetail, SDL_Color outerColor, SDL_Color innerColor);
+    size_t drawAnimation(shared_ptr<const Animation> animation, shared_ptr<const Polyhedron> poly,
+                         shared_ptr<const PolyhedronLod> lod, SDL_Color outerColor, SDL_Color innerColor);
+    void drawDeviation(const Polyhedron& poly, const DeviationReport& deviation);
+
+    GeometryStore& store_;
+    mutex mutex_;
+    condition_variable wake_;
+    deque<function<void()> > jobs_;
+    bool openRequested_ = false;
+    bool stopping_ = false;
+
+    // Only touched by the thread inside run()
+    SDL_Window* window_ = nullptr;
+    SDL_Renderer* renderer_ = nullptr;
+    float angleX_ = 0.5f, angleY_ = 0.5f;
+    vector<SDL_Point> projected_;    // Reused by every instance of every frame
+    chrono::steady_clock::time_point lastRotation_;
+    double edgesPerMs_ = 0;          // Measured drawing rate, smoothed over frames
+    unique_ptr<AnimationPlayer> player_;
+    chrono::steady_clock::time_point animationStart_;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "weld.h"
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+using namespace std;
+
+// Helper function to hash integer grid cell coordinates into one key
+static uint64_t cellKey(int64_t cx, int64_t cy, int64_t cz) {
+    uint64_t h = static_cast<uint64_t>(cx) * 0x9E3779B97F4A7C15ULL;
+    h ^= static_cast<uint64_t>(cy) * 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+    h ^= static_cast<uint64_t>(cz) * 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+// Largest cell coordinate used, 2^52. Past it the tolerance is below the
+// spacing of doubles at that magnitude, and casting the cell coordinate could
+// overflow int64_t.
+static const double WELD_MAX_CELL = 4503599627370496.0;
+
+// Helper function to merge only vertices with identical coordinates; vertices
+// with a NaN coordinate are kept apart
+static size_t weldExact(vector<Vertex>& vertices, vector<int>& remap) {
+    map<Vertex, int> index;
+    vector<Vertex> kept;
+    kept.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        if (std::isnan(v.x) || std::isnan(v.y) || std::isnan(v.z)) {
+            remap[i] = static_cast<int>(kept.size());
+            kept.push_back(v);
+            continue;
+        }
+        auto inserted = index.insert(make_pair(v, static_cast<int>(kept.size())));
+        if (inserted.second) kept.push_back(v);
+        remap[i] = inserted.first->second;
+    }
+    size_t merged = vertices.size() - kept.size();
+    kept.shrink_to_fit();
+    vertices.swap(kept);
+    return merged;
+}
+
+size_t weldVertexTable(vector<Vertex>& vertices, double tolerance, vector<int>& remap) {
+    size_t n = vertices.size();
+    remap.resize(n);
+    for (size_t i = 0; i < n; ++i) remap[i] = static_cast<int>(i);
+    if (tolerance <= 0 || n < 2) return 0;
+
+    // The fallback also covers NaN and infinite coordinates, and a tolerance
+    // so small that its inverse overflows
+    double inv = 1.0 / tolerance;
+    double extent = 0;
+    for (const Vertex& v : vertices) {
+        extent = max(extent, max(fabs(v.x), max(fabs(v.y), fabs(v.z))));
+        if (std::isnan(v.x) || std::isnan(v.y) || std::isnan(v.z)) extent = HUGE_VAL;
+    }
+    if (!(extent * inv <= WELD_MAX_CELL)) return weldExact(vertices, remap);
+
+    // Cells are one tolerance wide, so any match lies in the 3x3x3 block
+    // around a vertex's own cell. Kept vertices are chained per cell through
+    // `next`; distinct cells that hash to the same key only cost an extra
+    // distance test, never a wrong merge.
+    double tol2 = tolerance * tolerance;
+    unordered_map<uint64_t, int> head;
+    head.reserve(n);
+    vector<int> next(n, -1);
+    vector<Vertex> kept;
+    kept.reserve(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        const Vertex& v = vertices[i];
+        int64_t cx = static_cast<int64_t>(floor(v.x * inv));
+        int64_t cy = static_cast<int64_t>(floor(v.y * inv));
+        int64_t cz = static_cast<int64_t>(floor(v.z * inv));
+
+        int match = -1;
+        for (int dx = -1; dx <= 1 && match < 0; ++dx) {
+            for (int dy = -1; dy <= 1 && match < 0; ++dy) {
+                for (int dz = -1; dz <= 1 && match < 0; ++dz) {
+                    auto it = head.find(cellKey(cx + dx, cy + dy, cz + dz));
+                    if (it == head.end()) continue;
+                    for (int k = it->second; k >= 0; k = next[k]) {
+                        const Vertex& w = kept[k];
+                        double ex = v.x - w.x, ey = v.y - w.y, ez = v.z - w.z;
+                        if (ex * ex + ey * ey + ez * ez <= tol2) {
+                            match = k;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (match < 0) {
+            match = static_cast<int>(kept.size());
+            kept.push_back(v);
+            uint64_t key = cellKey(cx, cy, cz);
+            auto it = head.find(key);
+            if (it != head.end()) {
+                next[match] = it->second;
+                it->second = match;
+            } else {
+                head[key] = match;
+            }
+        }
+        remap[i] = match;
+    }
+
+    size_t merged = n - kept.size();
+    kept.shrink_to_fit();
+    vertices.swap(kept);
+    return merged;
+}
+
+WeldReport weldPolyhedron(Polyhedron& poly, double tolerance) {
+    WeldReport report;
+    report.verticesBefore = poly.vertices.size();
+
+    vector<int> remap;
+    size_t merged = weldVertexTable(poly.vertices, tolerance, remap);
+    report.verticesAfter = poly.vertices.size();
+    report.bytesSaved = merged * sizeof(Vertex);
+
+    if (merged > 0) {
+        for (auto& face : poly.faces) {
+            size_t kept = 0;
+            for (size_t j = 0; j < face.edges.size(); ++j) {
+                Edge edge = face.edges[j];
+                edge.i1 = remap[edge.i1];
+                edge.i2 = remap[edge.i2];
+                if (edge.i1 == edge.i2) {
+                    report.edgesCollapsed++;
+                    continue;
+                }
+                edge.v1 = poly.vertices[edge.i1];
+                edge.v2 = poly.vertices[edge.i2];
+                double dx = edge.v2.x - edge.v1.x;
+                double dy = edge.v2.y - edge.v1.y;
+                double dz = edge.v2.z - edge.v1.z;
+                edge.length = sqrt(dx * dx + dy * dy + dz * dz);
+                face.edges[kept++] = edge;
+            }
+            if (kept < face.edges.size()) {
+                report.bytesSaved += (face.edges.size() - kept) * sizeof(Edge);
+                face.edges.resize(kept);
+                face.edges.shrink_to_fit();
+            }
+        }
+    }
+
+    for (auto& sub : poly.sub_polyhedrons) {
+        WeldReport subReport = weldPolyhedron(sub, tolerance);
+        report.verticesBefore += subReport.verticesBefore;
+        report.verticesAfter += subReport.verticesAfter;
+        report.edgesCollapsed += subReport.edgesCollapsed;
+        report.bytesSaved += subReport.bytesSaved;
+    }
+    return report;
+}
+
+void printWeldReport(const WeldReport& report) {
+    printf("Welded %zu vertices into %zu (%zu merged, %zu degenerate edges removed, %zu bytes saved)\n",
+           report.verticesBefore, report.verticesAfter, report.verticesBefore - report.verticesAfter,
+           report.edgesCollapsed, report.bytesSaved);
+}
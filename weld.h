@@ -0,0 +1,28 @@
+#ifndef WELD_H
+#define WELD_H
+
+#include "input.h"
+
+// Summary of a welding pass, summed over a polyhedron and its holes
+struct WeldReport {
+    size_t verticesBefore;
+    size_t verticesAfter;
+    size_t edgesCollapsed; // Edges whose two end points were merged into one
+    size_t bytesSaved;     // Vertex and edge storage released by the merge
+
+    WeldReport() : verticesBefore(0), verticesAfter(0), edgesCollapsed(0), bytesSaved(0) {}
+};
+
+// Merges vertices closer than `tolerance` using a uniform-grid spatial hash
+// (O(n) expected). `vertices` is compacted in place and remap[i] receives the
+// new index of old vertex i. Returns the number of vertices merged away.
+// When the coordinates exceed 2^52 tolerances, only identical vertices merge.
+size_t weldVertexTable(vector<Vertex>& vertices, double tolerance, vector<int>& remap);
+
+// Welds each shell's vertices and rewrites its edges to the merged indices and
+// values, dropping edges that collapse to a point. Holes are welded separately.
+WeldReport weldPolyhedron(Polyhedron& poly, double tolerance = WELD_TOLERANCE);
+
+void printWeldReport(const WeldReport& report);
+
+#endif